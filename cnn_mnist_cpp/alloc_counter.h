@@ -0,0 +1,46 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+// Replaces the global operator new/delete to count heap allocations.
+// Include from exactly one translation unit (a driver's .cpp) only.
+
+#include <new>
+#include <cstdlib>
+#include <atomic>
+#include <cstddef>
+
+inline std::atomic<long> g_heap_allocations{0};
+
+inline long heap_allocations() { return g_heap_allocations.load(std::memory_order_relaxed); }
+
+// Kept out of line so GCC does not pair an inlined malloc()/free() with
+// operator new/delete and raise -Wmismatched-new-delete at call sites.
+#define ALLOC_COUNTER_NOINLINE __attribute__((noinline))
+
+ALLOC_COUNTER_NOINLINE void* operator new(std::size_t n) {
+    g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+ALLOC_COUNTER_NOINLINE void* operator new(std::size_t n, std::align_val_t al) {
+    g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    std::size_t a = static_cast<std::size_t>(al);
+    if (void* p = std::aligned_alloc(a, (n + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t n) { return operator new(n); }
+void* operator new[](std::size_t n, std::align_val_t al) { return operator new(n, al); }
+
+
+ALLOC_COUNTER_NOINLINE void operator delete(void* p) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete[](void* p) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+#endif
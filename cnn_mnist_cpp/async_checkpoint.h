@@ -0,0 +1,157 @@
+#ifndef ASYNC_CHECKPOINT_H
+#define ASYNC_CHECKPOINT_H
+
+#include "checkpoint.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+// ───────────────────────────
+// AsyncCheckpointer
+// Periodic checkpoints that keep disk I/O off the training thread.
+// snapshot() copies the tensors into a preallocated snapshot buffer (a
+// few MB of memcpy, no allocation) and returns; a background thread then
+// serializes that buffer with save_checkpoint (atomic temp file + rename).
+//
+// Two snapshot buffers alternate: the writer owns one while the caller
+// fills the other. If the writer is still busy when the next snapshot
+// arrives, the not-yet-written one is replaced, so training never waits
+// on disk and the newest state is always what gets written next. The
+// writer runs at idle priority, so with every core busy training it may
+// fall behind and skip intermediate snapshots; flush() waits for the last.
+//
+// Write errors are kept and rethrown by the next snapshot() or flush().
+class AsyncCheckpointer {
+public:
+    AsyncCheckpointer(const std::vector<NamedTensor>& tensors, std::string path) : path_(std::move(path)) {
+        std::size_t total = 0;
+        for (const NamedTensor& t : tensors) total += t.tensor->size();
+        for (int b = 0; b < 2; ++b) {
+            buffers_[b].assign(total, 0.0);
+            views_[b].reserve(tensors.size());
+            std::size_t offset = 0;
+            for (const NamedTensor& t : tensors) {
+                views_[b].push_back(Tensor::view_like(buffers_[b].data() + offset, *t.tensor));
+                offset += t.tensor->size();
+            }
+            for (std::size_t i = 0; i < tensors.size(); ++i) named_[b].push_back({tensors[i].name, &views_[b][i]});
+        }
+        sources_ = tensors;
+        writer_ = std::thread([this] { writer_loop(); });
+    }
+
+    // Writes whatever snapshot is still pending, then stops the writer
+    ~AsyncCheckpointer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_.notify_all();
+        writer_.join();
+    }
+
+    AsyncCheckpointer(const AsyncCheckpointer&) = delete;
+    AsyncCheckpointer& operator=(const AsyncCheckpointer&) = delete;
+
+    // Copy the current tensors and queue them for writing; returns how
+    // long the caller was stalled, in seconds
+    double snapshot() {
+        auto t0 = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            rethrow();
+            std::size_t offset = 0;
+            for (const NamedTensor& t : sources_) {
+                std::copy(t.tensor->begin(), t.tensor->end(), buffers_[pending_].begin() + offset);
+                offset += t.tensor->size();
+            }
+            replaced_ += has_pending_;
+            has_pending_ = true;
+            ++snapshots_;
+        }
+        work_.notify_one();
+        double stall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        stall_seconds_ += stall;
+        return stall;
+    }
+
+    // Block until the last snapshot is on disk
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return !has_pending_ && !writing_; });
+        rethrow();
+    }
+
+    int snapshots() const { return snapshots_; }
+    double stall_seconds() const { return stall_seconds_; } // total time snapshot() held up the caller
+    // Checkpoints written, snapshots replaced before being written, and
+    // seconds spent writing; consistent after flush()
+    int written() const { return written_; }
+    int replaced() const { return replaced_; }
+    double write_seconds() const { return write_seconds_; }
+
+private:
+    std::string path_;
+    std::vector<NamedTensor> sources_;
+    AlignedVector<double> buffers_[2];
+    std::vector<Tensor> views_[2];         // the tensors' shapes over each buffer
+    std::vector<NamedTensor> named_[2];
+    std::thread writer_;
+
+    std::mutex mutex_;
+    std::condition_variable work_, done_;
+    int pending_ = 0;            // buffer snapshot() fills; the writer owns the other
+    bool has_pending_ = false;   // buffers_[pending_] holds a snapshot not yet taken by the writer
+    bool writing_ = false;
+    bool stopping_ = false;
+    std::string error_;
+    int snapshots_ = 0, written_ = 0, replaced_ = 0;
+    double stall_seconds_ = 0.0, write_seconds_ = 0.0;
+
+    void rethrow() {
+        if (error_.empty()) return;
+        std::string error = std::move(error_);
+        error_.clear();
+        throw std::runtime_error(error);
+    }
+
+    void writer_loop() {
+        // Idle priority: the writer runs when a core is free instead of
+        // preempting a training thread the moment snapshot() wakes it
+        sched_param idle{};
+        pthread_setschedparam(pthread_self(), SCHED_IDLE, &idle);
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            work_.wait(lock, [this] { return stopping_ || has_pending_; });
+            if (!has_pending_) return; // stopping, nothing left to write
+            int buffer = pending_;
+            pending_ = 1 - pending_;
+            has_pending_ = false;
+            writing_ = true;
+            lock.unlock();
+
+            auto t0 = std::chrono::steady_clock::now();
+            std::string error;
+            try {
+                save_checkpoint(named_[buffer], path_);
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+            lock.lock();
+            writing_ = false;
+            write_seconds_ += seconds;
+            if (error.empty()) ++written_;
+            else error_ = error;
+            done_.notify_all();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,1337 @@
+#include "alloc_counter.h"
+#include "model.h"
+#include "static_model.h"
+#include "data_parallel.h"
+#include "hogwild.h"
+#include "prefetch.h"
+#include "binary_dataset.h"
+#include "streaming.h"
+#include "utils.h"
+#include "async_checkpoint.h"
+#include "evaluation.h"
+#include "inference_server.h"
+#include "quantized.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <utility>
+#include <tuple>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <unistd.h>
+
+// Synthetic-input benchmark: no dataset or OpenCV needed.
+// Reports heap allocations and wall time per training step.
+
+static Tensor4D random_batch(int batch, std::mt19937& gen, int channels = 1, int h = 28, int w = 28) {
+    std::uniform_real_distribution<double> pixel(0.0, 1.0);
+    Tensor4D x(batch, channels, h, w);
+    for (double& v : x) v = pixel(gen);
+    return x;
+}
+
+// Bind a standalone layer the same way CNN binds its layers
+template <typename Layer>
+static void bind_layer(Layer& layer, Workspace& ws, const Tensor& x) {
+    ws.rewind();
+    layer.bind(ws, x);
+    if (ws.overflowed()) {
+        ws.reserve(ws.requested());
+        layer.bind(ws, x);
+    }
+}
+
+template <typename F>
+static double seconds_per_call(F&& f, int reps) {
+    f(); // warm-up
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; ++r) f();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count() / reps;
+}
+
+// Largest |a - ref| relative to max(1, |ref|)
+static double max_rel_diff(const Tensor& a, const Tensor& ref) {
+    double d = 0.0;
+    for (std::size_t k = 0; k < a.size(); ++k)
+        d = std::max(d, std::abs(a[k] - ref[k]) / std::max(1.0, std::abs(ref[k])));
+    return d;
+}
+
+// Returns heap allocations per warmed-up step
+long bench_training_step(int batch_size = 64, int warmup = 3, int steps = 20) {
+    std::mt19937 gen(42);
+    CNN model;
+    Tensor4D x = random_batch(batch_size, gen);
+    std::vector<int> y(batch_size);
+    for (int b = 0; b < batch_size; ++b) y[b] = b % 10;
+
+    for (int s = 0; s < warmup; ++s) {
+        model.forward(x, y);
+        model.backward(0.01);
+    }
+
+    long allocs_before = heap_allocations();
+    auto t0 = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; ++s) {
+        model.forward(x, y);
+        model.backward(0.01);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    long allocs = heap_allocations() - allocs_before;
+    double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+    std::cout << "⏱️  Training step (batch " << batch_size << "): "
+              << std::fixed << std::setprecision(2) << ms / steps << " ms/step, "
+              << allocs / steps << " heap allocations/step\n";
+    return allocs / steps;
+}
+
+// Conv2D forward throughput per backend, checked against the direct loop
+bool bench_conv_forward(int batch, int in_ch, int out_ch, int hw, int reps) {
+    std::mt19937 gen(7);
+    Tensor4D x = random_batch(batch, gen, in_ch, hw, hw);
+    Conv2D conv(in_ch, out_ch, 3);
+    Workspace ws;
+    bind_layer(conv, ws, x);
+
+    conv.backend = ConvBackend::Direct;
+    Tensor4D reference = conv.forward(x);
+
+    int out_hw = hw - 2;
+    double flops = 2.0 * batch * out_ch * out_hw * out_hw * in_ch * 9;
+    std::cout << "🧮 Conv2D forward " << in_ch << "→" << out_ch << " 3×3 on " << hw << "×" << hw
+              << ", batch " << batch << ":\n";
+
+    bool ok = true;
+    const std::pair<ConvBackend, const char*> backends[] = {
+        {ConvBackend::Direct, "direct"}, {ConvBackend::Im2col, "im2col"},
+        {ConvBackend::Simd3x3, "simd3x3"}, {ConvBackend::Winograd, "winograd"}};
+    for (auto [backend, name] : backends) {
+        conv.backend = backend;
+        double s = seconds_per_call([&] { conv.forward(x); }, reps);
+        double err = max_rel_diff(conv.output, reference);
+        ok = ok && err < 1e-9;
+        std::cout << "   " << std::setw(8) << name << ": " << std::fixed << std::setprecision(2)
+                  << flops / s * 1e-9 << " GFLOP/s, max rel. Δ vs direct "
+                  << std::scientific << std::setprecision(1) << err << std::defaultfloat << "\n";
+    }
+    return ok;
+}
+
+// Conv2D backward (dW and dX) per backend, checked against the direct loop
+bool bench_conv_backward(int batch, int in_ch, int out_ch, int hw, int reps) {
+    std::mt19937 gen(11);
+    Tensor4D x = random_batch(batch, gen, in_ch, hw, hw);
+    Tensor4D d_out = random_batch(batch, gen, out_ch, hw - 2, hw - 2);
+    Conv2D conv(in_ch, out_ch, 3);
+    Workspace ws;
+    bind_layer(conv, ws, x);
+    conv.forward(x);
+
+    conv.backend = ConvBackend::Direct;
+    conv.backward(d_out);
+    Tensor4D ref_dw = conv.dw, ref_dx = conv.d_input;
+
+    int out_hw = hw - 2;
+    double flops = 2.0 * 2.0 * batch * out_ch * out_hw * out_hw * in_ch * 9; // dW + dX
+    std::cout << "🧮 Conv2D backward " << in_ch << "→" << out_ch << " 3×3 on " << hw << "×" << hw
+              << ", batch " << batch << ":\n";
+
+    bool ok = true;
+    const std::pair<ConvBackend, const char*> backends[] = {
+        {ConvBackend::Direct, "direct"}, {ConvBackend::Im2col, "im2col"},
+        {ConvBackend::Winograd, "winograd"}};
+    for (auto [backend, name] : backends) {
+        conv.backend = backend;
+        double s = seconds_per_call([&] { conv.backward(d_out); }, reps);
+        double err = std::max(max_rel_diff(conv.dw, ref_dw), max_rel_diff(conv.d_input, ref_dx));
+        ok = ok && err < 1e-9;
+        std::cout << "   " << std::setw(8) << name << ": " << std::fixed << std::setprecision(2)
+                  << flops / s * 1e-9 << " GFLOP/s, max rel. Δ vs direct "
+                  << std::scientific << std::setprecision(1) << err << std::defaultfloat << "\n";
+    }
+    return ok;
+}
+
+// The original Dense loops (i innermost, W walked down a column)
+static void dense_reference(const Matrix& x, const Matrix& w, const Tensor& biases,
+                            const Matrix& d_out, Matrix& out, Matrix& dw, Matrix& dx) {
+    int batch = x.dim(0), in_dim = w.dim(0), out_dim = w.dim(1);
+    for (int b = 0; b < batch; ++b)
+        for (int j = 0; j < out_dim; ++j) {
+            out(b, j) = biases[j];
+            for (int i = 0; i < in_dim; ++i) out(b, j) += x(b, i) * w(i, j);
+        }
+    dw.zero();
+    dx.zero();
+    for (int b = 0; b < batch; ++b)
+        for (int j = 0; j < out_dim; ++j)
+            for (int i = 0; i < in_dim; ++i) {
+                dw(i, j) += x(b, i) * d_out(b, j);
+                dx(b, i) += d_out(b, j) * w(i, j);
+            }
+}
+
+// Dense forward and backward (dW = Xᵀ·dY, dX = dY·Wᵀ) on the GEMM engine
+// against the original loops, at the fc1/fc2 shapes
+bool bench_dense(int batch, int in_dim, int out_dim, int reps) {
+    std::mt19937 gen(29);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    Matrix x(batch, in_dim), d_out(batch, out_dim);
+    for (double& v : x) v = normal(gen);
+    for (double& v : d_out) v = normal(gen);
+    Dense fc(in_dim, out_dim);
+    Workspace ws;
+    bind_layer(fc, ws, x);
+
+    Matrix ref_out(batch, out_dim), ref_dw(in_dim, out_dim), ref_dx(batch, in_dim);
+    double s_ref = seconds_per_call([&] {
+        dense_reference(x, fc.weights, fc.biases, d_out, ref_out, ref_dw, ref_dx);
+    }, reps);
+    double s_fwd = seconds_per_call([&] { fc.forward(x); }, reps);
+    double s_bwd = seconds_per_call([&] { fc.backward(d_out); }, reps);
+    double err = std::max({max_rel_diff(fc.output, ref_out), max_rel_diff(fc.d_weights, ref_dw),
+                           max_rel_diff(fc.d_input, ref_dx)});
+
+    double flops = 2.0 * batch * in_dim * out_dim; // per product
+    std::cout << "🧱 Dense " << in_dim << "→" << out_dim << ", batch " << batch << ": loops "
+              << std::fixed << std::setprecision(2) << 3 * flops / s_ref * 1e-9 << " GFLOP/s, GEMM forward "
+              << flops / s_fwd * 1e-9 << " GFLOP/s, backward " << 2 * flops / s_bwd * 1e-9
+              << " GFLOP/s (" << s_ref / (s_fwd + s_bwd) << "× step), max rel. Δ "
+              << std::scientific << std::setprecision(1) << err << std::defaultfloat << "\n";
+    return err < 1e-9;
+}
+
+// Dense step (forward + backward) on the sparse path vs the GEMM path as
+// the fraction of non-zero inputs grows; prints where the GEMM takes over
+bool bench_dense_sparsity(int batch, int in_dim, int out_dim, int reps) {
+    std::mt19937 gen(31);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    Matrix x(batch, in_dim), d_out(batch, out_dim);
+    for (double& v : d_out) v = normal(gen);
+    Dense fc(in_dim, out_dim);
+    fc.zero_inputs_discard_grad = true;
+    Workspace ws;
+    bind_layer(fc, ws, x);
+
+    std::cout << "🕳️  Dense " << in_dim << "→" << out_dim << ", batch " << batch
+              << ", step time GEMM vs sparse by input density:\n";
+    bool ok = true;
+    double crossover = -1.0;
+    for (double density : {0.02, 0.05, 0.1, 0.2, 0.3, 0.4, 0.5, 0.7, 1.0}) {
+        for (double& v : x) v = unit(gen) < density ? std::abs(normal(gen)) : 0.0;
+        auto step = [&] {
+            fc.forward(x);
+            fc.backward(d_out);
+        };
+        fc.sparse_below = 0.0;
+        double s_dense = seconds_per_call(step, reps);
+        Matrix ref_out = fc.output, ref_dw = fc.d_weights, ref_dx = fc.d_input;
+        fc.sparse_below = 2.0;
+        double s_sparse = seconds_per_call(step, reps);
+
+        // d_input is only defined at the non-zero inputs on the sparse path
+        for (std::size_t k = 0; k < x.size(); ++k)
+            if (x[k] == 0.0) ref_dx[k] = 0.0;
+        double err = std::max({max_rel_diff(fc.output, ref_out), max_rel_diff(fc.d_weights, ref_dw),
+                               max_rel_diff(fc.d_input, ref_dx)});
+        ok = ok && err < 1e-9;
+        if (crossover < 0.0 && s_sparse > s_dense) crossover = density;
+        std::cout << "   " << std::fixed << std::setprecision(0) << std::setw(4) << fc.input_density() * 100
+                  << "%: " << std::setprecision(3) << s_dense * 1e3 << " ms vs " << s_sparse * 1e3
+                  << " ms, max rel. Δ " << std::scientific << std::setprecision(1) << err
+                  << std::defaultfloat << "\n";
+    }
+    if (crossover < 0.0)
+        std::cout << "   sparse path wins at every density\n";
+    else
+        std::cout << "   GEMM path wins from ~" << std::fixed << std::setprecision(0) << crossover * 100
+                  << "% non-zero inputs\n" << std::defaultfloat;
+    return ok;
+}
+
+// Winograd error in units of ε·Σ|x·w| (the bound documented in winograd.h)
+void bench_winograd_accuracy(int batch, int in_ch, int out_ch, int hw) {
+    std::mt19937 gen(17);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    Tensor4D x(batch, in_ch, hw, hw);
+    for (double& v : x) v = normal(gen);
+    Conv2D conv(in_ch, out_ch, 3);
+    Workspace ws;
+    bind_layer(conv, ws, x);
+
+    conv.backend = ConvBackend::Direct;
+    Tensor4D reference = conv.forward(x);
+    conv.backend = ConvBackend::Winograd;
+    conv.forward(x);
+
+    double worst = 0.0;
+    int out_hw = hw - 2;
+    for (int b = 0; b < batch; ++b)
+        for (int o = 0; o < out_ch; ++o)
+            for (int i = 0; i < out_hw; ++i)
+                for (int j = 0; j < out_hw; ++j) {
+                    double s = 0.0;
+                    for (int c = 0; c < in_ch; ++c)
+                        for (int m = 0; m < 3; ++m)
+                            for (int n = 0; n < 3; ++n)
+                                s += std::abs(x(b, c, i + m, j + n) * conv.weights(o, c, m, n));
+                    double err = std::abs(conv.output(b, o, i, j) - reference(b, o, i, j));
+                    worst = std::max(worst, err / (s * std::numeric_limits<double>::epsilon()));
+                }
+    std::cout << "🎯 Winograd " << in_ch << "→" << out_ch << " max |Δ| vs direct: "
+              << std::fixed << std::setprecision(2) << worst << " ε·Σ|x·w| (bound " << 9 * in_ch + 16 << ")\n";
+}
+
+// Images/sec of the 3×3 kernel family at every ISA level this CPU has
+bool bench_conv3x3_isa(int batch, int reps) {
+    std::mt19937 gen(13);
+    Tensor4D x = random_batch(batch, gen);
+    Conv2D conv(1, 10, 3);
+    Workspace ws;
+    bind_layer(conv, ws, x);
+    conv.backend = ConvBackend::Direct;
+    Tensor4D reference = conv.forward(x);
+
+    SimdLevel best = detect_simd_level();
+    std::cout << "🧮 Conv2D(1, 10, 3) 3×3 kernels, batch " << batch
+              << " (dispatch picks " << simd_level_name(best) << "):\n";
+
+    bool ok = true;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level > best) break;
+        Conv3x3Kernel kernel = conv3x3_kernel(level);
+        double s = seconds_per_call([&] {
+            for (int b = 0; b < batch; ++b)
+                kernel(x.sample(b), 1, 28, 28, conv.weights.data(), conv.biases.data(), 10, conv.output.sample(b));
+        }, reps);
+        double err = max_rel_diff(conv.output, reference);
+        ok = ok && err < 1e-9;
+        std::cout << "   " << std::setw(8) << simd_level_name(level) << ": " << std::fixed << std::setprecision(0)
+                  << batch / s << " images/s, max rel. Δ vs direct "
+                  << std::scientific << std::setprecision(1) << err << std::defaultfloat << "\n";
+    }
+    return ok;
+}
+
+// Fused Conv2D → ReLU → MaxPool2D against the three separate layers
+bool bench_fused_conv_block(int batch, int reps) {
+    std::mt19937 gen(23);
+    Tensor4D x = random_batch(batch, gen);
+    CNN model;
+    std::vector<int> y(batch);
+    for (int b = 0; b < batch; ++b) y[b] = b % 10;
+
+    model.fuse_conv_block = false;
+    double loss_separate = model.forward(x, y);
+    model.backward();
+    Tensor4D dw_separate = model.c1.dw;
+    double s_separate = seconds_per_call([&] { model.predict(x); }, reps);
+
+    model.fuse_conv_block = true;
+    double loss_fused = model.forward(x, y);
+    model.backward();
+    double err = std::max(std::abs(loss_fused - loss_separate), max_rel_diff(model.c1.dw, dw_separate));
+    double s_fused = seconds_per_call([&] { model.predict(x); }, reps);
+
+    std::cout << "🔗 predict() batch " << batch << ", separate vs fused conv→relu→pool: "
+              << std::fixed << std::setprecision(2) << s_separate * 1e3 << " ms vs " << s_fused * 1e3
+              << " ms, max Δ (loss, dW) " << std::scientific << std::setprecision(1) << err
+              << std::defaultfloat << "\n";
+
+    Conv2D conv(1, 10, 3);
+    ReLU relu;
+    MaxPool2D pool;
+    ConvReLUPool fused;
+    Workspace ws;
+    auto bind_all = [&] {
+        conv.bind(ws, x);
+        relu.bind(ws, conv.output);
+        pool.bind(ws, relu.output);
+        fused.bind(ws, conv, x);
+    };
+    bind_all();
+    ws.reserve(ws.requested());
+    bind_all();
+    double s_layers = seconds_per_call([&] { pool.forward(relu.forward(conv.forward(x))); }, reps);
+    double s_block = seconds_per_call([&] { fused.forward(conv, x); }, reps);
+    err = std::max(err, max_rel_diff(fused.output, pool.output));
+    std::cout << "🔗 conv→relu→pool block alone: " << std::fixed << std::setprecision(2)
+              << s_layers * 1e3 << " ms vs " << s_block * 1e3 << " ms\n" << std::defaultfloat;
+    return err < 1e-9;
+}
+
+// Largest parameter difference between two models
+static double max_param_diff(const CNN& a, const CNN& b) {
+    double d = 0.0;
+    for (std::size_t k = 0; k < a.parameters.size(); ++k)
+        d = std::max(d, std::abs(a.parameters[k] - b.parameters[k]) / std::max(1.0, std::abs(b.parameters[k])));
+    return d;
+}
+
+// Start a model from saved parameters
+static void set_parameters(CNN& m, const AlignedVector<double>& values) {
+    std::copy(values.begin(), values.end(), m.parameters.begin());
+    m.weights_changed();
+}
+
+// Data-parallel training: parity with the single-thread step for 1–4
+// threads, then images/sec for 1..hardware threads
+bool bench_data_parallel(int batch, int steps) {
+    std::mt19937 gen(37);
+    Tensor4D x = random_batch(batch, gen);
+    std::vector<int> y(batch);
+    for (int b = 0; b < batch; ++b) y[b] = b % 10;
+    const double lr = 0.05;
+
+    CNN reference;
+    AlignedVector<double> init = reference.parameters;
+    for (int s = 0; s < steps; ++s) {
+        reference.forward(x, y);
+        reference.backward(lr);
+    }
+
+
+    bool ok = true;
+    std::cout << "🧵 Data-parallel step vs single thread, " << steps << " steps of batch " << batch << ":";
+    for (int threads = 1; threads <= 4; ++threads) {
+        CNN model;
+        set_parameters(model, init);
+        DataParallelTrainer trainer(model, threads);
+        for (int s = 0; s < steps; ++s) trainer.step(x, y, lr);
+        double err = max_param_diff(model, reference);
+        ok = ok && err < 1e-9;
+        std::cout << " " << threads << "t Δ " << std::scientific << std::setprecision(1) << err;
+    }
+    std::cout << std::defaultfloat << "\n";
+
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "🧵 Scaling (" << max_threads << " hardware threads):";
+    double base = 0.0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        CNN model;
+        DataParallelTrainer trainer(model, threads);
+        long allocs = 0;
+        double s = seconds_per_call([&] {
+            long before = heap_allocations();
+            trainer.step(x, y, 0.01);
+            allocs = heap_allocations() - before;
+        }, steps);
+        double ips = batch / s;
+        if (threads == 1) base = ips;
+        ok = ok && allocs == 0;
+        std::cout << " " << threads << "t " << std::fixed << std::setprecision(0) << ips << " img/s ("
+                  << std::setprecision(2) << ips / base << "×, " << allocs << " allocs)";
+        if (threads < max_threads && threads * 2 > max_threads) threads = max_threads / 2;
+    }
+    std::cout << std::defaultfloat << "\n";
+    return ok;
+}
+
+// Learnable synthetic digits: a bright 6×6 patch whose position (with
+// ±2 px jitter) encodes the class, over uniform noise
+static Dataset synthetic_digits(int n, std::mt19937& gen) {
+    std::uniform_real_distribution<double> noise(0.0, 0.6);
+    std::uniform_int_distribution<int> jitter(-2, 2);
+    Dataset d(Tensor4D(n, 1, 28, 28), std::vector<int>(n));
+    Tensor4D& x = d.images;
+    for (int b = 0; b < n; ++b) {
+        int label = b % 10;
+        d.labels[b] = label;
+        for (int i = 0; i < 28; ++i)
+            for (int j = 0; j < 28; ++j) x(b, 0, i, j) = noise(gen);
+        int top = 3 + (label / 5) * 12 + jitter(gen), left = 1 + (label % 5) * 5 + jitter(gen);
+        for (int i = 0; i < 6; ++i)
+            for (int j = 0; j < 6; ++j)
+                x(b, 0, std::clamp(top + i, 0, 27), std::clamp(left + j, 0, 27)) = 1.0;
+    }
+    return d;
+}
+
+static double accuracy(CNN& model, const Dataset& data) {
+    std::vector<int> preds = model.predict(data.images);
+    int correct = 0;
+    for (std::size_t i = 0; i < preds.size(); ++i) correct += preds[i] == data.labels[i];
+    return double(correct) / preds.size();
+}
+
+// Wall time (training only) until test accuracy reaches `target`:
+// synchronous data-parallel steps vs Hogwild
+void bench_time_to_accuracy(int threads, double target, int max_epochs) {
+    std::mt19937 gen(41);
+    Dataset train = synthetic_digits(1000, gen);
+    Dataset test = synthetic_digits(200, gen);
+    const int batch = 64;
+    const double lr = 0.02;
+
+    AlignedVector<double> init = CNN().parameters;
+    auto run = [&](bool hogwild) {
+        CNN model;
+        set_parameters(model, init);
+        std::unique_ptr<DataParallelTrainer> sync;
+        std::unique_ptr<HogwildTrainer> async;
+        if (hogwild)
+            async = std::make_unique<HogwildTrainer>(model, threads);
+        else
+            sync = std::make_unique<DataParallelTrainer>(model, threads);
+        DataLoader loader(train, batch, true, 5);
+        Batch b;
+
+        double seconds = 0.0;
+        for (int epoch = 1; epoch <= max_epochs; ++epoch) {
+            loader.start_epoch();
+            auto t0 = std::chrono::steady_clock::now();
+            if (hogwild)
+                async->epoch(train, loader.order(), batch, lr);
+            else
+                while (loader.next(b)) sync->step(b.x, b.y, lr);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            double acc = accuracy(model, test);
+            if (acc >= target) {
+                std::cout << std::fixed << std::setprecision(2) << seconds << " s (" << epoch << " epochs)";
+                return;
+            }
+        }
+        std::cout << "not reached in " << max_epochs << " epochs (" << std::fixed << std::setprecision(2)
+                  << seconds << " s)";
+    };
+
+    std::cout << "🐗 Time to " << std::fixed << std::setprecision(0) << target * 100 << "% test accuracy, "
+              << threads << " thread(s) - synchronous: ";
+    run(false);
+    std::cout << ", Hogwild: ";
+    run(true);
+    std::cout << std::defaultfloat << "\n";
+}
+
+// Parameter update cost: the old per-layer SGD loops over six separately
+// allocated arrays vs one fused pass over CNN's contiguous block. The pass
+// is memory-bound and this box is noisy, so the variants take turns for a
+// few rounds and each keeps its best time.
+void bench_optimizer_update(int reps) {
+    CNN model;
+    std::mt19937 gen(43);
+    std::normal_distribution<double> normal(0.0, 1e-3);
+    for (double& g : model.gradients) g = normal(gen);
+
+    std::vector<Tensor> values, grads; // same sizes, one allocation each
+    for (const Tensor* t : {&model.c1.weights, &model.c1.biases, &model.fc1.weights,
+                            &model.fc1.biases, &model.fc2.weights, &model.fc2.biases}) {
+        values.emplace_back(*t);
+        grads.emplace_back(*t);
+    }
+    double lr = 0.01;
+    Optimizer optimizers[] = {Optimizer::sgd(lr), Optimizer::with_momentum(lr), Optimizer::adam()};
+    const char* names[] = {"fused SGD", "momentum", "Adam"};
+    double s_scattered = 1e30, s_fused[3] = {1e30, 1e30, 1e30};
+    for (int round = 0; round < 5; ++round) {
+        s_scattered = std::min(s_scattered, seconds_per_call([&] {
+            for (std::size_t i = 0; i < values.size(); ++i)
+                for (std::size_t k = 0; k < values[i].size(); ++k) values[i][k] -= lr * grads[i][k];
+        }, reps));
+        for (int o = 0; o < 3; ++o)
+            s_fused[o] = std::min(s_fused[o], seconds_per_call([&] {
+                optimizers[o].step(model.parameters.data(), model.gradients.data(), model.parameters.size());
+            }, reps));
+    }
+
+    std::cout << "🧮 Parameter update over " << model.parameters.size() << " values: per-layer SGD loops "
+              << std::fixed << std::setprecision(1) << s_scattered * 1e6 << " µs";
+    for (int o = 0; o < 3; ++o) std::cout << ", " << names[o] << " " << s_fused[o] * 1e6 << " µs";
+    std::cout << " (fused SGD " << std::setprecision(2) << s_scattered / s_fused[0] << "× per-layer)"
+              << std::defaultfloat << "\n";
+}
+
+// Epochs and wall time until test accuracy reaches `target` per optimizer,
+// single thread, same initial weights and batch order
+void bench_optimizers_to_accuracy(double target, int max_epochs) {
+    std::mt19937 gen(47);
+    Dataset train = synthetic_digits(1000, gen);
+    Dataset test = synthetic_digits(200, gen);
+    const int batch = 64;
+    AlignedVector<double> init = CNN().parameters;
+
+    std::cout << "📈 Epochs to " << std::fixed << std::setprecision(0) << target * 100 << "% test accuracy:";
+    const std::pair<Optimizer, const char*> optimizers[] = {
+        {Optimizer::sgd(0.02), "SGD"}, {Optimizer::with_momentum(0.005), "momentum"}, {Optimizer::adam(1e-3), "Adam"}};
+    for (auto [opt, name] : optimizers) {
+        CNN model;
+        set_parameters(model, init);
+        DataLoader loader(train, batch, true, 5);
+        Batch b;
+
+        double seconds = 0.0;
+        int reached = 0;
+        for (int epoch = 1; epoch <= max_epochs && !reached; ++epoch) {
+            loader.start_epoch();
+            auto t0 = std::chrono::steady_clock::now();
+            while (loader.next(b)) {
+                model.forward(b.x, b.y);
+                model.backward();
+                model.update(opt);
+            }
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            if (accuracy(model, test) >= target) reached = epoch;
+        }
+        std::cout << " " << name << " ";
+        if (reached)
+            std::cout << reached << " (" << std::setprecision(2) << seconds << " s)";
+        else
+            std::cout << ">" << max_epochs;
+        std::cout << std::setprecision(0);
+    }
+    std::cout << std::defaultfloat << "\n";
+}
+
+// Per-epoch input pipeline: the old loop (full shuffled copy of the set,
+// then a freshly allocated tensor per step) vs DataLoader gathering each
+// batch straight into its reusable buffer. Also checks the batches match.
+bool bench_data_loader(int n, int batch, int epochs) {
+    std::mt19937 gen(53);
+    Dataset data(random_batch(n, gen), std::vector<int>(n));
+    for (int i = 0; i < n; ++i) data.labels[i] = i % 10;
+    std::size_t image = data.sample_size();
+    double checksum_old = 0.0, checksum_new = 0.0;
+
+    std::vector<int> indices(n);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::mt19937 gen_old(7);
+    long allocs_old = heap_allocations();
+    double s_old = seconds_per_call([&] {
+        std::shuffle(indices.begin(), indices.end(), gen_old);
+        Tensor4D shuffled(n, 1, 28, 28);
+        std::vector<int> y_shuffled;
+        for (int k = 0; k < n; ++k) {
+            std::copy_n(data.images.sample(indices[k]), image, shuffled.sample(k));
+            y_shuffled.push_back(data.labels[indices[k]]);
+        }
+        for (int i = 0; i < n; i += batch) {
+            int end = std::min(i + batch, n);
+            Tensor4D x_batch(end - i, 1, 28, 28);
+            std::copy(shuffled.sample(i), shuffled.sample(end), x_batch.data());
+            std::vector<int> y_batch(y_shuffled.begin() + i, y_shuffled.begin() + end);
+            checksum_old += x_batch[0] + y_batch[0];
+        }
+    }, epochs);
+    allocs_old = heap_allocations() - allocs_old;
+
+    DataLoader loader(data, batch, true, 7);
+    Batch b;
+    b.y.reserve(batch);
+    long allocs_new = heap_allocations();
+    double s_new = seconds_per_call([&] {
+        loader.start_epoch();
+        while (loader.next(b)) checksum_new += b.x[0] + b.y[0];
+    }, epochs);
+    allocs_new = heap_allocations() - allocs_new;
+
+    double mb_old = 2.0 * n * image * sizeof(double) / 1e6; // whole set copied twice
+    double mb_new = 1.0 * n * image * sizeof(double) / 1e6; // each sample gathered once
+    std::cout << "🔀 Shuffled batches (" << n << " samples, batch " << batch << "), copy-per-epoch vs DataLoader: "
+              << std::fixed << std::setprecision(2) << s_old * 1e3 << " ms vs " << s_new * 1e3 << " ms per epoch, ~"
+              << std::setprecision(1) << mb_old << " vs " << mb_new << " MB copied, "
+              << allocs_old / epochs << " vs " << allocs_new / epochs << " allocations"
+              << std::defaultfloat << "\n";
+    return checksum_old == checksum_new;
+}
+
+// Training epochs fed by DataLoader (gather on the training thread) vs
+// PrefetchLoader (gathered ahead on a loader thread). Same seed, so both
+// see the same batches and must end with the same weights.
+bool bench_prefetch(int n, int batch, int epochs) {
+    std::mt19937 gen(59);
+    Dataset data = synthetic_digits(n, gen);
+    AlignedVector<double> init = CNN().parameters;
+
+    CNN serial_model;
+    set_parameters(serial_model, init);
+    DataLoader serial(data, batch, true, 11);
+    Batch b;
+    double s_serial = 0.0, wait_serial = 0.0;
+    for (int e = 0; e < epochs; ++e) {
+        serial.start_epoch();
+        auto t0 = std::chrono::steady_clock::now();
+        for (;;) {
+            auto w0 = std::chrono::steady_clock::now();
+            bool more = serial.next(b);
+            wait_serial += std::chrono::duration<double>(std::chrono::steady_clock::now() - w0).count();
+            if (!more) break;
+            serial_model.forward(b.x, b.y);
+            serial_model.backward(0.01);
+        }
+        s_serial += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    CNN prefetch_model;
+    set_parameters(prefetch_model, init);
+    PrefetchLoader prefetch(data, batch, true, 11);
+    double s_prefetch = 0.0, wait_prefetch = 0.0;
+    for (int e = 0; e < epochs; ++e) {
+        prefetch.start_epoch();
+        auto t0 = std::chrono::steady_clock::now();
+        while (prefetch.next(b)) {
+            prefetch_model.forward(b.x, b.y);
+            prefetch_model.backward(0.01);
+        }
+        s_prefetch += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        wait_prefetch += prefetch.wait_seconds();
+    }
+
+    double diff = max_param_diff(serial_model, prefetch_model);
+    std::cout << "📬 Epoch of " << n << " samples, inline gather vs prefetch thread: " << std::fixed
+              << std::setprecision(1) << s_serial / epochs * 1e3 << " ms (data " << wait_serial / epochs * 1e3
+              << " ms) vs " << s_prefetch / epochs * 1e3 << " ms (waited " << wait_prefetch / epochs * 1e3
+              << " ms), max |Δw| " << std::scientific << std::setprecision(1) << diff << std::defaultfloat << "\n";
+    return diff == 0.0;
+}
+
+// CSV and IDX → binary dataset round trip on synthetic digits quantized to
+// k/255: the mapped file must decode to exactly the same samples
+bool bench_binary_dataset(int n) {
+    std::mt19937 gen(61);
+    Dataset data = synthetic_digits(n, gen);
+    for (double& v : data.images) v = std::round(v * 255.0) / 255.0;
+    std::string dir = "/tmp/cnn_bench_dataset_" + std::to_string(::getpid()) + "/";
+    std::filesystem::create_directories(dir);
+
+    {
+        std::ofstream images(dir + "images.csv"), labels(dir + "labels.csv");
+        images << std::setprecision(7);
+        for (int i = 0; i < n; ++i) {
+            for (std::size_t p = 0; p < data.sample_size(); ++p)
+                images << (p ? "," : "") << float(data.images.sample(i)[p]);
+            images << "\n";
+            labels << data.labels[i] << "\n";
+        }
+        std::ofstream img_idx(dir + "images.idx", std::ios::binary), lbl_idx(dir + "labels.idx", std::ios::binary);
+        auto be32 = [](std::ofstream& out, std::uint32_t v) {
+            char b[4] = {char(v >> 24), char(v >> 16), char(v >> 8), char(v)};
+            out.write(b, 4);
+        };
+        be32(img_idx, 0x803); be32(img_idx, n); be32(img_idx, 28); be32(img_idx, 28);
+        be32(lbl_idx, 0x801); be32(lbl_idx, n);
+        for (double v : data.images) img_idx.put(char(std::lround(v * 255.0)));
+        for (int y : data.labels) lbl_idx.put(char(y));
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    double csv_error = convert_csv_to_binary(dir + "images.csv", dir + "labels.csv", dir + "csv.bin");
+    double s_convert = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    convert_idx_to_binary(dir + "images.idx", dir + "labels.idx", dir + "idx.bin");
+
+    // Pixels on the k/256 grid (mnist.pkl.gz) are reported as rounded, and
+    // a label that does not fit in a byte is refused
+    {
+        std::ofstream images(dir + "k256.csv"), labels(dir + "k256_labels.csv"), bad(dir + "bad_labels.csv");
+        for (int p = 0; p < 28 * 28; ++p) images << (p ? "," : "") << (p % 256) / 256.0;
+        images << "\n";
+        labels << "7\n";
+        bad << "256\n";
+    }
+    double k256_error = convert_csv_to_binary(dir + "k256.csv", dir + "k256_labels.csv", dir + "k256.bin");
+    bool label_refused = false;
+    try {
+        convert_csv_to_binary(dir + "k256.csv", dir + "bad_labels.csv", dir + "bad.bin");
+    } catch (const std::runtime_error&) {
+        label_refused = true;
+    }
+
+    // CsvReader::parse_pixels (the converter's and the packed CSV loader's
+    // reader) keeps raw 0–255 cells rather than clamping them
+    {
+        std::ofstream raw(dir + "raw.csv");
+        for (int p = 0; p < 28 * 28; ++p) raw << (p ? "," : "") << p % 256;
+        raw << "\n";
+    }
+    std::vector<std::uint8_t> raw(28 * 28);
+    bool raw_kept = CsvReader(dir + "raw.csv").parse_pixels(raw.data()) == 0.0;
+    for (int p = 0; p < 28 * 28; ++p) raw_kept = raw_kept && raw[p] == p % 256;
+
+    bool ok = csv_error < 1e-6 && k256_error > 1e-6 && k256_error <= 0.5 / 255 && label_refused && raw_kept;
+    double s_map = 0.0;
+    for (const char* name : {"csv.bin", "idx.bin"}) {
+        t0 = std::chrono::steady_clock::now();
+        MappedDataset file(dir + name);
+        Dataset back = file.to_dataset();
+        s_map = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        ok = ok && back.labels == data.labels && back.images.size() == data.images.size() &&
+             std::equal(back.images.begin(), back.images.end(), data.images.begin());
+    }
+    std::filesystem::remove_all(dir);
+    std::cout << "💽 Binary dataset (" << n << " samples): CSV parse+convert " << std::fixed << std::setprecision(1)
+              << s_convert * 1e3 << " ms, mmap+decode " << s_map * 1e3 << " ms, round trip "
+              << (ok ? "exact" : "MISMATCH") << ", k/256 pixels off by up to " << std::scientific
+              << std::setprecision(1) << k256_error << std::defaultfloat << "\n";
+    return ok;
+}
+
+// The getline/stod parser load_csv_images used to be (reference)
+static std::vector<std::vector<double>> legacy_load_csv(const std::string& filename) {
+    std::vector<std::vector<double>> data;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::stringstream ss(line);
+        std::string val;
+        std::vector<double> row;
+        while (std::getline(ss, val, ',')) {
+            try {
+                row.push_back(std::stod(val));
+            } catch (...) {
+                row.push_back(0.0);
+            }
+        }
+        data.push_back(row);
+    }
+    return data;
+}
+
+// CSV parsing throughput on an MNIST-like file (export_to_csv.py format,
+// ~80% zero pixels): legacy parser vs CsvReader on 1 and N threads, next to
+// a plain memcpy of the same number of bytes. Also checks that malformed
+// cells are reported with their line and column.
+bool bench_csv_reader(int rows, int threads) {
+    std::mt19937 gen(67);
+    std::uniform_int_distribution<int> pixel(0, 255);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::string path = "/tmp/cnn_bench_csv_" + std::to_string(::getpid()) + ".csv";
+    {
+        std::ofstream out(path);
+        char cell[32];
+        for (int r = 0; r < rows; ++r) {
+            for (int p = 0; p < 28 * 28; ++p) {
+                float v = u(gen) < 0.8 ? 0.0f : pixel(gen) / 255.0f;
+                int len = std::snprintf(cell, sizeof(cell), p ? ",%.7g" : "%.7g", v);
+                out.write(cell, len);
+            }
+            out << "\n";
+        }
+    }
+    double bytes = std::filesystem::file_size(path);
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::vector<double>> legacy = legacy_load_csv(path);
+    double s_legacy = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    bool ok = true;
+    std::cout << "📑 CSV parse (" << rows << " rows, " << std::fixed << std::setprecision(0) << bytes / 1e6
+              << " MB): getline/stod " << std::setprecision(2) << bytes / s_legacy / 1e9 << " GB/s";
+    for (int t : {1, threads}) {
+        AlignedVector<double> values(std::size_t(rows) * 28 * 28);
+        double s = seconds_per_call([&] {
+            CsvReader reader(path, t);
+            reader.parse(values.data());
+        }, 3);
+        for (int r = 0; r < rows; ++r)
+            ok = ok && std::equal(legacy[r].begin(), legacy[r].end(), values.begin() + std::size_t(r) * 784);
+        std::cout << ", CsvReader " << t << "t " << bytes / s / 1e9 << " GB/s";
+        if (t == threads) break;
+    }
+    std::vector<char> src(static_cast<std::size_t>(bytes), 1), dst(src.size());
+    double s_copy = seconds_per_call([&] { std::memcpy(dst.data(), src.data(), src.size()); }, 3);
+    std::cout << ", memcpy " << bytes / s_copy / 1e9 << " GB/s" << std::defaultfloat << "\n";
+    std::filesystem::remove(path);
+
+    // Malformed cells must be reported, not read as 0
+    {
+        std::ofstream out(path);
+        out << "1,2,3\n4,x,6\n7,8\n\n9,10,11\r\n";
+    }
+    std::string message;
+    try {
+        CsvReader reader(path, threads);
+        std::vector<double> values(reader.rows() * reader.cols());
+        reader.parse(values.data());
+    } catch (const std::runtime_error& e) {
+        message = e.what();
+    }
+    std::filesystem::remove(path);
+    bool reported = message.find("2 malformed") != std::string::npos &&
+                    message.find("line 2, column 2: 'x'") != std::string::npos &&
+                    message.find("line 3: 2 cells, expected 3") != std::string::npos;
+    if (!reported) std::cout << "❌ Malformed CSV not reported: " << message << "\n";
+    return ok && reported;
+}
+
+// Packed uint8 dataset vs doubles: bytes held and the cost of one epoch of
+// shuffled batch gathers (dequantizing on the fly for the packed one).
+// Both must produce exactly the same batches.
+bool bench_packed_dataset(int n, int batch, int epochs) {
+    std::mt19937 gen(71);
+    Dataset doubles = synthetic_digits(n, gen);
+    for (double& v : doubles.images) v = std::round(v * 255.0) / 255.0;
+    Dataset packed = doubles.pack();
+
+    double s[2];
+    double checksum[2] = {0.0, 0.0};
+    bool same = true;
+    const Dataset* sets[2] = {&doubles, &packed};
+    for (int k = 0; k < 2; ++k) {
+        DataLoader loader(*sets[k], batch, true, 13);
+        Batch b;
+        b.y.reserve(batch);
+        s[k] = seconds_per_call([&] {
+            loader.start_epoch();
+            while (loader.next(b)) checksum[k] += b.x[0] + b.x[b.x.size() - 1] + b.y[0];
+        }, epochs);
+    }
+    DataLoader a(doubles, batch, true, 17), p(packed, batch, true, 17);
+    Batch ba, bp;
+    a.start_epoch();
+    p.start_epoch();
+    while (a.next(ba) && p.next(bp))
+        same = same && ba.y == bp.y && std::equal(ba.x.begin(), ba.x.end(), bp.x.begin());
+
+    std::cout << "🗜️  Dataset of " << n << " samples, doubles vs packed uint8: " << std::fixed << std::setprecision(1)
+              << doubles.bytes() / 1e6 << " MB vs " << packed.bytes() / 1e6 << " MB, shuffled epoch "
+              << std::setprecision(2) << s[0] * 1e3 << " ms vs " << s[1] * 1e3 << " ms, batches "
+              << (same && checksum[0] == checksum[1] ? "identical" : "DIFFER") << std::defaultfloat << "\n";
+    return same && checksum[0] == checksum[1];
+}
+
+// Streaming from a file: balanced sampling must match the in-memory rule,
+// a shuffled epoch must visit every sample once within the memory budget
+bool bench_streaming(int n, int per_class, std::size_t budget) {
+    std::mt19937 gen(83);
+    Dataset packed = synthetic_digits(n, gen).pack();
+    std::string path = "/tmp/cnn_bench_stream_" + std::to_string(::getpid()) + ".bin";
+    std::vector<std::uint8_t> labels(packed.labels.begin(), packed.labels.end());
+    write_binary_dataset(path, std::vector<std::uint8_t>(packed.pixels.begin(), packed.pixels.end()), labels);
+
+    DatasetStream stream(path, 1000);
+    Dataset first = sample_balanced(stream, per_class);
+    Dataset expected = packed.subset(balanced_indices(n, [&](int i) { return packed.labels[i]; }, per_class));
+    bool ok = first.labels == expected.labels && first.pixels == expected.pixels;
+    Dataset uniform = sample_balanced(stream, per_class, true, 5);
+    int count[10] = {};
+    for (int y : uniform.labels) ++count[y];
+    ok = ok && std::all_of(count, count + 10, [&](int c) { return c == per_class; });
+
+    // Each sample's checksum, to see every one come out exactly once
+    auto key = [](const double* x, int y) {
+        double k = y;
+        for (int p = 0; p < 28 * 28; p += 37) k = k * 1.000001 + x[p];
+        return k;
+    };
+    std::vector<double> want, got;
+    DataLoader in_order(packed, 64, false);
+    Batch b;
+    for (in_order.start_epoch(); in_order.next(b);)
+        for (int i = 0; i < b.size(); ++i) want.push_back(key(b.x.sample(i), b.y[i]));
+
+    StreamingLoader loader(path, 64, budget, true, 9);
+    ok = ok && loader.memory_bytes() <= budget;
+    double s_stream = seconds_per_call([&] {
+        got.clear();
+        for (loader.start_epoch(); loader.next(b);)
+            for (int i = 0; i < b.size(); ++i) got.push_back(key(b.x.sample(i), b.y[i]));
+    }, 3);
+    bool shuffled = got != want;
+    std::sort(got.begin(), got.end());
+    std::vector<double> sorted = want;
+    std::sort(sorted.begin(), sorted.end());
+    ok = ok && shuffled && got == sorted;
+
+    StreamingLoader sequential(path, 64, budget, false);
+    got.clear();
+    for (sequential.start_epoch(); sequential.next(b);)
+        for (int i = 0; i < b.size(); ++i) got.push_back(key(b.x.sample(i), b.y[i]));
+    ok = ok && got == want;
+
+    // A budget with room for one batch but no shuffle buffer is refused
+    // when shuffling, and fine for reading in file order
+    std::size_t one_batch = 64 * (28 * 28 * sizeof(double) + sizeof(int)) + 2 * (28 * 28 + 1);
+    bool refused = false;
+    try { StreamingLoader tight(path, 64, one_batch, true); } catch (const std::runtime_error&) { refused = true; }
+    StreamingLoader tight(path, 64, one_batch, false);
+    ok = ok && refused;
+
+    DataLoader in_memory(packed, 64, true, 9);
+    double s_memory = seconds_per_call([&] { for (in_memory.start_epoch(); in_memory.next(b);) {} }, 3);
+    std::remove(path.c_str());
+
+    std::cout << "🌊 Streaming " << n << " samples (" << std::fixed << std::setprecision(1) << packed.bytes() / 1e6
+              << " MB) in a " << budget / 1e6 << " MB budget: shuffle buffer " << loader.shuffle_capacity()
+              << ", loader memory " << loader.memory_bytes() / 1e6 << " MB, epoch " << std::setprecision(2)
+              << s_stream * 1e3 << " ms vs " << s_memory * 1e3 << " ms in memory, balanced sampling and coverage "
+              << (ok ? "exact" : "WRONG") << std::defaultfloat << "\n";
+    return ok;
+}
+
+// The text format earlier versions saved (one file per tensor)
+static void legacy_save_text_model(const CNN& model, const std::string& prefix) {
+    auto save = [&](const Tensor& t, const std::string& name) {
+        std::ofstream out(prefix + "_" + name + ".txt");
+        for (int d = 0; d < t.rank(); ++d) out << (d ? " " : "") << t.dim(d);
+        out << "\n" << std::setprecision(17);
+        for (double v : t) out << v << " ";
+        out << "\n";
+    };
+    save(model.c1.weights, "c1_weights");
+    save(model.c1.biases, "c1_biases");
+    save(model.fc1.weights, "fc1_weights");
+    save(model.fc1.biases, "fc1_biases");
+    save(model.fc2.weights, "fc2_weights");
+    save(model.fc2.biases, "fc2_biases");
+}
+
+// Binary checkpoint vs the text files: size, save/load time, exact round
+// trip, and rejection of a corrupted or truncated file
+bool bench_checkpoint(int reps) {
+    CNN model, loaded, imported;
+    std::string dir = "/tmp/cnn_bench_ckpt_" + std::to_string(::getpid()) + "/";
+    std::filesystem::create_directories(dir);
+
+    double s_save_text = seconds_per_call([&] { legacy_save_text_model(model, dir + "model"); }, reps);
+    double s_load_text = seconds_per_call([&] { import_text_model(imported, dir + "model"); }, reps);
+    double s_save = seconds_per_call([&] { save_model(model, dir + "model.ckpt"); }, reps);
+    double s_load = seconds_per_call([&] { load_model(loaded, dir + "model.ckpt"); }, reps);
+    std::uintmax_t text_bytes = 0;
+    for (const auto& f : std::filesystem::directory_iterator(dir))
+        if (f.path().extension() == ".txt") text_bytes += f.file_size();
+    std::uintmax_t ckpt_bytes = std::filesystem::file_size(dir + "model.ckpt");
+
+    bool ok = loaded.parameters == model.parameters && imported.parameters == model.parameters;
+    auto rejects = [&](std::uintmax_t size, long flip) {
+        std::filesystem::copy_file(dir + "model.ckpt", dir + "bad.ckpt", std::filesystem::copy_options::overwrite_existing);
+        if (flip >= 0) {
+            std::fstream f(dir + "bad.ckpt", std::ios::in | std::ios::out | std::ios::binary);
+            f.seekp(flip);
+            f.put('\x5a');
+        }
+        std::filesystem::resize_file(dir + "bad.ckpt", size);
+        try {
+            load_model(loaded, dir + "bad.ckpt");
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    bool rejected = rejects(ckpt_bytes, long(ckpt_bytes / 2)) && rejects(ckpt_bytes - 64, -1);
+    std::size_t files = std::distance(std::filesystem::directory_iterator(dir), std::filesystem::directory_iterator());
+    std::filesystem::remove_all(dir);
+
+    std::cout << "💾 Checkpoint, text vs binary: " << std::fixed << std::setprecision(2) << text_bytes / 1e6
+              << " MB vs " << ckpt_bytes / 1e6 << " MB, save " << std::setprecision(1) << s_save_text * 1e3
+              << " ms vs " << s_save * 1e3 << " ms, load " << s_load_text * 1e3 << " ms vs " << std::setprecision(2)
+              << s_load * 1e3 << " ms, round trip " << (ok ? "exact" : "MISMATCH") << ", corruption "
+              << (rejected ? "rejected" : "ACCEPTED") << std::defaultfloat << "\n";
+    return ok && rejected && files == 8; // six .txt, model.ckpt, bad.ckpt: no temp file left behind
+}
+
+// Checkpoint between training steps: how long the training thread stalls
+// with a synchronous save vs a background one, and what ends up on disk
+bool bench_async_checkpoint(int checkpoints, int steps_between) {
+    std::mt19937 gen(89);
+    Tensor4D x = random_batch(64, gen);
+    std::vector<int> y(64);
+    for (int b = 0; b < 64; ++b) y[b] = b % 10;
+    std::string path = "/tmp/cnn_bench_async_" + std::to_string(::getpid()) + ".ckpt";
+
+    CNN model;
+    double s_sync = 0.0;
+    for (int c = 0; c < checkpoints; ++c) {
+        for (int s = 0; s < steps_between; ++s) { model.forward(x, y); model.backward(0.01); }
+        s_sync += seconds_per_call([&] { save_model(model, path); }, 1);
+    }
+
+    AsyncCheckpointer checkpointer(model_tensors(model), path);
+    double worst = 0.0;
+    for (int c = 0; c < checkpoints; ++c) {
+        for (int s = 0; s < steps_between; ++s) { model.forward(x, y); model.backward(0.01); }
+        worst = std::max(worst, checkpointer.snapshot());
+    }
+    AlignedVector<double> last = model.parameters;
+    model.forward(x, y);
+    model.backward(0.01); // must not leak into the queued snapshot
+    checkpointer.flush();
+    CNN loaded;
+    load_model(loaded, path);
+    bool ok = loaded.parameters == last && checkpointer.written() + checkpointer.replaced() == checkpoints;
+    std::remove(path.c_str());
+
+    std::cout << "⏱️  Checkpoint stall per save, synchronous vs background: " << std::fixed << std::setprecision(2)
+              << s_sync / checkpoints * 1e3 << " ms vs " << checkpointer.stall_seconds() / checkpoints * 1e3
+              << " ms (worst " << worst * 1e3 << " ms), " << checkpointer.written() << " written, "
+              << checkpointer.replaced() << " superseded, last one " << (ok ? "exact" : "WRONG") << std::defaultfloat
+              << "\n";
+    return ok;
+}
+
+// What predict() did before infer(): the training forward pass (binding
+// the workspace for the whole batch, caching inputs and masks), then argmax
+static std::vector<int> training_path_predict(CNN& model, const Tensor4D& x) {
+    std::vector<int> y(x.dim(0), 0);
+    model.forward(x, y);
+    std::vector<int> predictions(x.dim(0));
+    for (int i = 0; i < x.dim(0); ++i) {
+        const double* row = model.fc2.output.sample(i);
+        predictions[i] = std::max_element(row, row + 10) - row;
+    }
+    return predictions;
+}
+
+// const predict() through infer() vs the training forward pass: same
+// predictions on every conv path, scratch memory, latency and throughput,
+// and concurrent calls on one model
+bool bench_inference(int batch, int reps) {
+    std::mt19937 gen(97);
+    Tensor4D x = random_batch(batch, gen);
+    Tensor4D one = random_batch(1, gen);
+    CNN model, reference;
+    set_parameters(reference, model.parameters);
+
+    bool ok = true;
+    for (bool fused : {true, false})
+        for (ConvBackend backend : {ConvBackend::Direct, ConvBackend::Im2col, ConvBackend::Simd3x3, ConvBackend::Winograd}) {
+            model.fuse_conv_block = reference.fuse_conv_block = fused;
+            model.c1.backend = reference.c1.backend = backend;
+            model.weights_changed();
+            ok = ok && model.predict(x) == training_path_predict(reference, x);
+        }
+
+    // Timings and memory at the default settings, on fresh models
+    CNN old_path, new_path;
+    set_parameters(new_path, old_path.parameters);
+    new_path.prepare_inference();
+    training_path_predict(old_path, x);
+    std::size_t old_bytes = old_path.workspace.capacity() * sizeof(double);
+    std::size_t new_bytes = new_path.infer_scratch_size(std::min(batch, CNN::infer_chunk), 28, 28) * sizeof(double);
+    double s_old_batch = seconds_per_call([&] { training_path_predict(old_path, x); }, reps);
+    double s_new_batch = seconds_per_call([&] { new_path.predict(x); }, reps);
+    double s_old_one = seconds_per_call([&] { training_path_predict(old_path, one); }, reps * 20);
+    double s_new_one = seconds_per_call([&] { new_path.predict(one); }, reps * 20);
+
+    // Four threads predicting on the same const model
+    const CNN& shared = model;
+    std::vector<int> expected = shared.predict(x);
+    std::vector<std::vector<int>> results(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&, t] {
+            for (int r = 0; r < 3; ++r) results[t] = shared.predict(x);
+        });
+    for (std::thread& t : threads) t.join();
+    bool concurrent = std::all_of(results.begin(), results.end(), [&](const auto& r) { return r == expected; });
+
+    std::cout << "🔮 predict(), training forward vs const infer(): scratch for batch " << batch << " "
+              << std::fixed << std::setprecision(1) << old_bytes / 1e6 << " MB vs " << new_bytes / 1e6
+              << " MB, latency (1 image) " << std::setprecision(3) << s_old_one * 1e3 << " ms vs " << s_new_one * 1e3
+              << " ms, " << std::setprecision(0) << batch / s_old_batch << " vs " << batch / s_new_batch
+              << " img/s, predictions " << (ok ? "identical" : "DIFFER") << ", 4 threads "
+              << (concurrent ? "consistent" : "INCONSISTENT") << std::defaultfloat << "\n";
+    return ok && concurrent;
+}
+
+// Sharded evaluation: the same predictions and confusion matrix from a
+// file stream and from memory at every thread count, and the throughput
+bool bench_sharded_eval(int n) {
+    std::mt19937 gen(101);
+    Dataset packed = synthetic_digits(n, gen).pack();
+    std::string path = "/tmp/cnn_bench_eval_" + std::to_string(::getpid()) + ".bin";
+    std::vector<std::uint8_t> labels(packed.labels.begin(), packed.labels.end());
+    write_binary_dataset(path, std::vector<std::uint8_t>(packed.pixels.begin(), packed.pixels.end()), labels);
+
+    CNN model;
+    DataLoader in_order(packed, n, false);
+    Batch all;
+    in_order.start_epoch();
+    in_order.next(all);
+    std::vector<int> expected = model.predict(all.x);
+    std::array<std::array<long, 10>, 10> confusion{};
+    for (int i = 0; i < n; ++i) ++confusion[packed.labels[i]][expected[i]];
+
+    bool ok = true;
+    std::cout << "🧮 Sharded eval of " << n << " images:";
+    double base = 0.0;
+    for (int threads : {1, 2, 4}) {
+        ShardedEvaluator evaluator(model, threads, 64);
+        Evaluation memory = evaluator.evaluate(packed);
+        DatasetStream stream(path, 1);
+        Evaluation streamed;
+        double s = seconds_per_call([&] { streamed = evaluator.evaluate(stream); }, 2);
+        ok = ok && memory.predictions == expected && streamed.predictions == expected &&
+             streamed.labels == packed.labels && memory.confusion == confusion && streamed.confusion == confusion;
+        if (threads == 1) base = s;
+        std::cout << " " << threads << (threads == 1 ? " thread " : " threads ") << std::fixed << std::setprecision(0)
+                  << n / s << " img/s (" << std::setprecision(2) << base / s << "×)" << (threads < 4 ? "," : "");
+    }
+    std::remove(path.c_str());
+    std::cout << ", results " << (ok ? "identical" : "DIFFER") << std::defaultfloat << "\n";
+    return ok;
+}
+
+// Inference server over a Unix socket: closed-loop clients with batching
+// off (max batch 1) vs dynamic batching; every answer must match predict()
+bool bench_inference_server(int clients, int requests) {
+    std::mt19937 gen(103);
+    Dataset images = synthetic_digits(500, gen).pack();
+    CNN model;
+    DataLoader in_order(images, images.size(), false);
+    Batch all;
+    in_order.start_epoch();
+    in_order.next(all);
+    images.labels = model.predict(all.x); // so `correct` counts answers that match predict()
+
+    bool ok = true;
+    std::cout << "🛰️  Inference server, " << clients << " clients:";
+    for (int max_batch : {1, 64}) {
+        std::string path = "/tmp/cnn_bench_serve_" + std::to_string(::getpid()) + ".sock";
+        BatchingOptions options;
+        options.max_batch = max_batch;
+        InferenceServer server(model, path, options);
+        std::thread accept([&] { server.serve(); });
+        LoadReport r = generate_load(path, images, clients, requests);
+        server.stop();
+        accept.join();
+        ok = ok && r.requests == long(clients) * requests && r.correct == r.requests;
+        std::cout << (max_batch == 1 ? " unbatched " : ", batched (mean ") << std::fixed << std::setprecision(1);
+        if (max_batch > 1) std::cout << server.batcher().mean_batch() << ") ";
+        std::cout << "p50 " << std::setprecision(2) << r.p50 * 1e3 << " ms p99 " << r.p99 * 1e3 << " ms "
+                  << std::setprecision(0) << r.throughput() << " img/s";
+    }
+    std::cout << ", answers " << (ok ? "identical" : "DIFFER") << std::defaultfloat << "\n";
+    return ok;
+}
+
+// Int8 engine: the AVX2 GEMM and requantize kernels against their scalar
+// versions (bit for bit), then agreement with the double model and speed,
+// both starting from packed uint8 images
+bool bench_quantized(int n, int reps) {
+    std::mt19937 gen(107);
+    bool exact = true;
+    for (auto [m, k, cols] : {std::tuple{7, 13, 10}, std::tuple{64, 1690, 128}, std::tuple{5, 128, 10}}) {
+        std::uniform_real_distribution<double> weight(-1.0, 1.0);
+        std::vector<double> w(std::size_t(k) * cols);
+        for (double& v : w) v = weight(gen);
+        Int8Weights b = Int8Weights::quantize(k, cols, [&](int i, int j) { return w[std::size_t(i) * cols + j]; });
+        AlignedVector<std::uint8_t> a(std::size_t(m) * b.k4);
+        for (auto& v : a) v = static_cast<std::uint8_t>(gen() % 128);
+        std::vector<std::int32_t> c_ref(std::size_t(m) * b.n16), c(c_ref.size());
+        gemm_u8s8_scalar(a.data(), m, b.k4, b, c_ref.data(), b.n16);
+        gemm_u8s8_dispatch()(a.data(), m, b.k4, b, c.data(), b.n16);
+        std::vector<float> mul(b.n16), add(b.n16);
+        for (int j = 0; j < b.n16; ++j) {
+            mul[j] = static_cast<float>(weight(gen) * 1e-3);
+            add[j] = static_cast<float>(weight(gen) * 64.0);
+        }
+        std::vector<std::uint8_t> q_ref(std::size_t(m) * b.n16), q(q_ref.size());
+        requantize_u7_scalar(c_ref.data(), m, b.n16, mul.data(), add.data(), q_ref.data(), b.n16);
+        requantize_u7_dispatch()(c_ref.data(), m, b.n16, mul.data(), add.data(), q.data(), b.n16);
+        exact = exact && c == c_ref && q == q_ref;
+    }
+
+    Dataset images = synthetic_digits(n, gen).pack();
+    CNN model;
+    QuantizedCNN quantized(model, images.subset(balanced_indices(n, [&](int i) { return images.labels[i]; }, 20)));
+    ShardedEvaluator evaluator(model, 1);
+    std::vector<int> expected = evaluator.evaluate(images).predictions;
+    std::vector<int> got = quantized.predict(images);
+    int agree = 0;
+    for (int i = 0; i < n; ++i) agree += got[i] == expected[i];
+
+    QuantizedCNN::Scratch scratch;
+    double s_double = seconds_per_call([&] { evaluator.evaluate(images); }, reps);
+    double s_int8 = seconds_per_call([&] { quantized.predict(images.pixels.data(), n, got.data(), scratch); }, reps);
+    std::cout << "🎚️  Int8 inference (" << (detect_simd_level() >= SimdLevel::AVX2 ? "avx2" : "scalar")
+              << " kernels " << (exact ? "exact" : "DIFFER") << "): " << std::fixed << std::setprecision(1)
+              << 100.0 * agree / n << "% same predictions as double, " << std::setprecision(0) << n / s_double
+              << " vs " << n / s_int8 << " img/s (" << std::setprecision(2) << s_double / s_int8 << "×)"
+              << std::defaultfloat << "\n";
+    return exact && agree >= 0.9 * n;
+}
+
+// Same network, shapes fixed at compile time vs read at runtime
+bool bench_static_vs_dynamic(int steps = 20) {
+    constexpr int batch = 64;
+    static fixed::CNN<batch> specialized; // several MB of std::arrays
+    std::mt19937 gen(19);
+    CNN dynamic;
+    specialized.load_from(dynamic);
+    Tensor4D x = random_batch(batch, gen);
+    std::vector<int> y(batch);
+    for (int b = 0; b < batch; ++b) y[b] = b % 10;
+
+    // One step on both, then the losses of the next forward must agree
+    dynamic.forward(x, y);
+    dynamic.backward(0.01);
+    specialized.forward(x, y);
+    specialized.backward(0.01);
+    double loss_dynamic = dynamic.forward(x, y);
+    double loss_specialized = specialized.forward(x, y);
+    double err = std::abs(loss_dynamic - loss_specialized);
+
+    // More images than MaxBatch: predict() goes chunk by chunk, forward() refuses
+    Tensor4D many = random_batch(2 * batch + 5, gen);
+    bool chunked = specialized.predict(many) == dynamic.predict(many);
+    bool refused = false;
+    try {
+        specialized.forward(many.data(), std::vector<int>(many.dim(0)).data(), many.dim(0));
+    } catch (const std::invalid_argument&) {
+        refused = true;
+    }
+
+    double s_dynamic = seconds_per_call([&] { dynamic.forward(x, y); dynamic.backward(0.01); }, steps);
+    double s_specialized = seconds_per_call([&] { specialized.forward(x, y); specialized.backward(0.01); }, steps);
+    std::cout << "📐 Training step (batch " << batch << "), dynamic vs fixed-shape templates: "
+              << std::fixed << std::setprecision(2) << s_dynamic * 1e3 << " ms vs "
+              << s_specialized * 1e3 << " ms (" << s_dynamic / s_specialized << "×), |Δloss| "
+              << std::scientific << std::setprecision(1) << err << std::defaultfloat << ", oversized batch "
+              << (chunked && refused ? "chunked / refused" : "MISHANDLED") << "\n";
+    return err < 1e-9 && chunked && refused;
+}
+
+int main() {
+    if (bench_training_step() != 0) {
+        std::cout << "❌ Warmed-up training step touched the heap\n";
+        return 1;
+    }
+
+    bool ok = bench_conv_forward(64, 1, 10, 28, 20);
+    ok = bench_conv_forward(64, 10, 32, 28, 3) && ok;
+    ok = bench_conv_forward(16, 32, 64, 28, 2) && ok;
+    ok = bench_conv3x3_isa(64, 50) && ok;
+    bench_winograd_accuracy(16, 1, 10, 28);
+    bench_winograd_accuracy(4, 32, 64, 28);
+    ok = bench_conv_backward(64, 1, 10, 28, 10) && ok;
+    ok = bench_conv_backward(16, 32, 64, 28, 2) && ok;
+    ok = bench_dense(64, 1690, 128, 10) && ok;
+    ok = bench_dense(64, 128, 10, 200) && ok;
+    ok = bench_dense(1, 1690, 128, 200) && ok;
+    ok = bench_dense_sparsity(64, 1690, 128, 10) && ok;
+    ok = bench_dense_sparsity(64, 128, 10, 200) && ok;
+    ok = bench_fused_conv_block(64, 20) && ok;
+    ok = bench_static_vs_dynamic() && ok;
+    ok = bench_data_parallel(64, 5) && ok;
+    int hw_threads = std::max(1u, std::thread::hardware_concurrency());
+    bench_time_to_accuracy(hw_threads, 0.95, 20);
+    if (hw_threads < 4) bench_time_to_accuracy(4, 0.95, 20);
+    bench_optimizer_update(200);
+    bench_optimizers_to_accuracy(0.95, 20);
+    ok = bench_data_loader(5000, 64, 10) && ok;
+    ok = bench_prefetch(1000, 64, 2) && ok;
+    ok = bench_binary_dataset(2000) && ok;
+    ok = bench_csv_reader(10000, std::max(4, hw_threads)) && ok;
+    ok = bench_packed_dataset(5000, 64, 10) && ok;
+    ok = bench_streaming(20000, 500, std::size_t(2) << 20) && ok;
+    ok = bench_checkpoint(5) && ok;
+    ok = bench_async_checkpoint(10, 5) && ok;
+    ok = bench_inference(1000, 3) && ok;
+    ok = bench_sharded_eval(2000) && ok;
+    ok = bench_inference_server(16, 50) && ok;
+    ok = bench_quantized(2000, 3) && ok;
+    if (!ok) {
+        std::cout << "❌ A kernel disagrees with its reference\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,191 @@
+#ifndef BINARY_DATASET_H
+#define BINARY_DATASET_H
+
+#include "dataset.h"
+#include "mapped_file.h"
+#include "csv_reader.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+
+// ───────────────────────────
+// Binary dataset file
+// One file per split, converted once from the CSVs (or the original IDX
+// files) and then memory-mapped, so startup does no parsing at all:
+//
+//   [header: 64 bytes]  magic "CNNDSET1", count, channels, height, width,
+//                       pixel and label offsets
+//   [pixels]            count·channels·height·width uint8, sample-major,
+//                       64-byte aligned; value p stands for p / 255
+//   [labels]            count uint8
+//
+// All integers are little-endian. The IDX files and CSVs of k/255 values
+// convert exactly; other values (e.g. k/256, as in mnist.pkl.gz) are
+// rounded to the nearest k/255, and convert_csv_to_binary says by how much.
+struct BinaryDatasetHeader {
+    char magic[8];
+    std::uint32_t count, channels, height, width;
+    std::uint64_t pixel_offset, label_offset;
+    std::uint8_t reserved[24];
+};
+static_assert(sizeof(BinaryDatasetHeader) == 64, "header must stay 64 bytes");
+
+constexpr char binary_dataset_magic[8] = {'C', 'N', 'N', 'D', 'S', 'E', 'T', '1'};
+
+// Write count samples of packed uint8 pixels and labels as a dataset file
+void write_binary_dataset(const std::string& path, const std::vector<std::uint8_t>& pixels,
+                          const std::vector<std::uint8_t>& labels, int channels = 1, int height = 28,
+                          int width = 28) {
+    std::size_t image = std::size_t(channels) * height * width;
+    if (pixels.size() != labels.size() * image)
+        throw std::runtime_error("write_binary_dataset: " + std::to_string(pixels.size()) +
+                                 " pixels for " + std::to_string(labels.size()) + " labels");
+
+    BinaryDatasetHeader h{};
+    std::memcpy(h.magic, binary_dataset_magic, sizeof(h.magic));
+    h.count = static_cast<std::uint32_t>(labels.size());
+    h.channels = channels;
+    h.height = height;
+    h.width = width;
+    h.pixel_offset = sizeof(BinaryDatasetHeader);
+    h.label_offset = (h.pixel_offset + pixels.size() + 63) / 64 * 64;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Cannot write " + path);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+    std::vector<char> pad(h.label_offset - h.pixel_offset - pixels.size(), 0);
+    out.write(pad.data(), pad.size());
+    out.write(reinterpret_cast<const char*>(labels.data()), labels.size());
+    if (!out) throw std::runtime_error("Failed writing " + path);
+}
+
+// ─── converters
+
+// From the repo's CSVs: one image per line, pixels either in [0, 1]
+// (export_to_csv.py) or raw 0–255. Returns the largest difference between
+// a pixel and the k/255 it is stored as, in [0, 1] units: ~1e-8 for k/255
+// printed to 7 digits, up to 1/510 for pixels on another grid.
+double convert_csv_to_binary(const std::string& images_csv, const std::string& labels_csv,
+                             const std::string& out_path) {
+    CsvReader images(images_csv), labels(labels_csv);
+    if (images.cols() != 28 * 28) throw std::runtime_error(images_csv + ": expected 784 pixels per row");
+    if (labels.rows() != images.rows())
+        throw std::runtime_error(labels_csv + ": " + std::to_string(labels.rows()) + " labels for " +
+                                 std::to_string(images.rows()) + " images");
+    std::vector<int> y(labels.rows() * labels.cols());
+    labels.parse(y.data());
+    for (std::size_t i = 0; i < y.size(); ++i)
+        if (y[i] < 0 || y[i] > 255)
+            throw std::runtime_error(labels_csv + ": label " + std::to_string(y[i]) + " on row " +
+                                     std::to_string(i + 1) + " does not fit in a byte");
+
+    std::vector<std::uint8_t> pixels(images.rows() * images.cols());
+    double error = images.parse_pixels(pixels.data());
+    write_binary_dataset(out_path, pixels, std::vector<std::uint8_t>(y.begin(), y.end()));
+    return error;
+}
+
+// From the original IDX files (train-images-idx3-ubyte, train-labels-idx1-ubyte)
+void convert_idx_to_binary(const std::string& images_idx, const std::string& labels_idx,
+                           const std::string& out_path) {
+    auto read_be32 = [](std::ifstream& in) {
+        unsigned char b[4];
+        in.read(reinterpret_cast<char*>(b), 4);
+        return std::uint32_t(b[0]) << 24 | std::uint32_t(b[1]) << 16 | std::uint32_t(b[2]) << 8 | b[3];
+    };
+    std::ifstream images(images_idx, std::ios::binary), labels(labels_idx, std::ios::binary);
+    if (!images) throw std::runtime_error("Cannot open " + images_idx);
+    if (!labels) throw std::runtime_error("Cannot open " + labels_idx);
+    if (read_be32(images) != 0x00000803) throw std::runtime_error(images_idx + ": not an IDX image file");
+    if (read_be32(labels) != 0x00000801) throw std::runtime_error(labels_idx + ": not an IDX label file");
+
+    std::uint32_t count = read_be32(images), rows = read_be32(images), cols = read_be32(images);
+    if (read_be32(labels) != count) throw std::runtime_error(labels_idx + ": label count mismatch");
+
+    std::vector<std::uint8_t> pixels(std::size_t(count) * rows * cols), y(count);
+    images.read(reinterpret_cast<char*>(pixels.data()), pixels.size());
+    labels.read(reinterpret_cast<char*>(y.data()), y.size());
+    if (!images || !labels) throw std::runtime_error(images_idx + ": truncated");
+    write_binary_dataset(out_path, pixels, y, 1, rows, cols);
+}
+
+// ───────────────────────────
+// MappedDataset
+// Read-only mmap of a dataset file. Samples are accessed in place
+// (pixels(i) points into the mapping); nothing is read until touched.
+class MappedDataset {
+public:
+    explicit MappedDataset(const std::string& path) : file_(path) {
+        if (file_.size() < sizeof(BinaryDatasetHeader)) throw std::runtime_error(path + ": not a dataset file");
+        base_ = reinterpret_cast<const std::uint8_t*>(file_.data());
+
+        std::memcpy(&header_, base_, sizeof(header_));
+        const BinaryDatasetHeader& h = header_;
+        std::size_t image = std::size_t(h.channels) * h.height * h.width;
+        if (std::memcmp(h.magic, binary_dataset_magic, sizeof(h.magic)) != 0 ||
+            h.pixel_offset + std::size_t(h.count) * image > file_.size() || h.label_offset + h.count > file_.size())
+            throw std::runtime_error(path + ": bad dataset header");
+    }
+
+    int size() const { return header_.count; }
+    int channels() const { return header_.channels; }
+    int height() const { return header_.height; }
+    int width() const { return header_.width; }
+    std::size_t sample_size() const { return std::size_t(header_.channels) * header_.height * header_.width; }
+
+    const std::uint8_t* pixels(int i) const { return base_ + header_.pixel_offset + i * sample_size(); }
+    int label(int i) const { return base_[header_.label_offset + i]; }
+
+    // Same rule as select_balanced_subset: the first per_class samples of
+    // each digit, in file order
+    std::vector<int> balanced_indices(int per_class) const {
+        return ::balanced_indices(size(), [this](int i) { return label(i); }, per_class);
+    }
+
+    // Decode the given samples into a Dataset of doubles in [0, 1]
+    Dataset to_dataset(const std::vector<int>& indices) const {
+        Dataset d(Tensor4D(static_cast<int>(indices.size()), channels(), height(), width()),
+                  std::vector<int>(indices.size()));
+        const double* value = Dataset::pixel_values();
+        std::size_t image = sample_size();
+        for (std::size_t k = 0; k < indices.size(); ++k) {
+            const std::uint8_t* src = pixels(indices[k]);
+            double* dst = d.images.sample(k);
+            for (std::size_t p = 0; p < image; ++p) dst[p] = value[src[p]];
+            d.labels[k] = label(indices[k]);
+        }
+        return d;
+    }
+
+    // Copy the given samples into a packed (uint8) Dataset, as stored
+    Dataset to_packed_dataset(const std::vector<int>& indices) const {
+        std::size_t image = sample_size();
+        AlignedVector<std::uint8_t> p(indices.size() * image);
+        std::vector<int> y(indices.size());
+        for (std::size_t k = 0; k < indices.size(); ++k) {
+            std::copy_n(pixels(indices[k]), image, p.data() + k * image);
+            y[k] = label(indices[k]);
+        }
+        return Dataset::packed(std::move(p), std::move(y), channels(), height(), width());
+    }
+
+    Dataset to_dataset() const {
+        std::vector<int> all(size());
+        std::iota(all.begin(), all.end(), 0);
+        return to_dataset(all);
+    }
+
+private:
+    MappedFile file_;
+    const std::uint8_t* base_ = nullptr;
+    BinaryDatasetHeader header_;
+};
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "tensor.h"
+#include "mapped_file.h"
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "checkpoints store raw little-endian doubles");
+
+// ───────────────────────────
+// Checkpoint file
+// One file holding every tensor of a model as raw doubles:
+//
+//   [header: 64 bytes]     magic "CNNCKPT1", version, tensor count, file
+//                          size, checksum of everything after the header
+//   [directory]            one 64-byte entry per tensor: name, shape,
+//                          offset and element count of its blob
+//   [blobs]                little-endian float64, each 64-byte aligned
+//
+// The checksum is 64-bit FNV-1a over 8-byte words, so a torn or corrupted
+// file is rejected instead of loading garbage. save_checkpoint writes a
+// temporary file, fsyncs it and renames it over the target: readers see
+// the old checkpoint or the new one, never half of one.
+struct CheckpointHeader {
+    char magic[8];
+    std::uint32_t version, tensor_count;
+    std::uint64_t file_size, checksum;
+    std::uint8_t reserved[32];
+};
+static_assert(sizeof(CheckpointHeader) == 64, "header must stay 64 bytes");
+
+struct CheckpointEntry {
+    char name[24];              // NUL-padded
+    std::uint32_t dtype;        // 0: float64
+    std::uint32_t rank;
+    std::uint32_t shape[4];
+    std::uint64_t offset, count;
+};
+static_assert(sizeof(CheckpointEntry) == 64, "directory entries must stay 64 bytes");
+
+constexpr char checkpoint_magic[8] = {'C', 'N', 'N', 'C', 'K', 'P', 'T', '1'};
+constexpr std::uint32_t checkpoint_version = 1;
+
+// FNV-1a, one 64-bit word at a time (sizes here are multiples of 8)
+inline std::uint64_t checkpoint_checksum(const char* data, std::size_t bytes) {
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (std::size_t i = 0; i + 8 <= bytes; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+// A named tensor to write
+struct NamedTensor {
+    std::string name;
+    const Tensor* tensor;
+};
+
+void save_checkpoint(const std::vector<NamedTensor>& tensors, const std::string& path) {
+    std::size_t directory_bytes = tensors.size() * sizeof(CheckpointEntry);
+    std::size_t offset = (sizeof(CheckpointHeader) + directory_bytes + 63) / 64 * 64;
+    std::vector<CheckpointEntry> directory(tensors.size());
+    for (std::size_t i = 0; i < tensors.size(); ++i) {
+        const Tensor& t = *tensors[i].tensor;
+        CheckpointEntry& e = directory[i];
+        e = CheckpointEntry{};
+        if (tensors[i].name.size() >= sizeof(e.name))
+            throw std::runtime_error("save_checkpoint: tensor name too long: " + tensors[i].name);
+        std::memcpy(e.name, tensors[i].name.data(), tensors[i].name.size());
+        e.rank = t.rank();
+        for (int d = 0; d < t.rank(); ++d) e.shape[d] = t.dim(d);
+        e.offset = offset;
+        e.count = t.size();
+        offset = (offset + t.size() * sizeof(double) + 63) / 64 * 64;
+    }
+
+    // Assemble the file in memory (a model is a few MB), then write it once
+    std::vector<char> file(offset, 0);
+    std::memcpy(file.data() + sizeof(CheckpointHeader), directory.data(), directory_bytes);
+    for (std::size_t i = 0; i < tensors.size(); ++i)
+        std::memcpy(file.data() + directory[i].offset, tensors[i].tensor->data(), directory[i].count * sizeof(double));
+    CheckpointHeader h{};
+    std::memcpy(h.magic, checkpoint_magic, sizeof(h.magic));
+    h.version = checkpoint_version;
+    h.tensor_count = static_cast<std::uint32_t>(tensors.size());
+    h.file_size = file.size();
+    h.checksum = checkpoint_checksum(file.data() + sizeof(h), file.size() - sizeof(h));
+    std::memcpy(file.data(), &h, sizeof(h));
+
+    static std::atomic<unsigned> serial{0}; // distinct temp files for concurrent writers
+    std::string tmp = path + ".tmp" + std::to_string(::getpid()) + "." + std::to_string(serial++);
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw std::runtime_error("Cannot write " + tmp);
+    const char* p = file.data();
+    std::size_t left = file.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n <= 0) break;
+        p += n;
+        left -= n;
+    }
+    bool ok = left == 0 && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        throw std::runtime_error("Failed writing " + path);
+    }
+    // Make the rename itself durable
+    std::size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+}
+
+// ───────────────────────────
+// Checkpoint
+// A checkpoint file mapped read-only. The header, directory bounds and
+// checksum are checked on open; tensors are then read straight from the
+// mapping, with no parsing.
+class Checkpoint {
+public:
+    explicit Checkpoint(const std::string& path) : path_(path), file_(path) {
+        if (file_.size() < sizeof(CheckpointHeader)) fail("not a checkpoint");
+        std::memcpy(&header_, file_.data(), sizeof(header_));
+        if (std::memcmp(header_.magic, checkpoint_magic, sizeof(header_.magic)) != 0) fail("not a checkpoint");
+        if (header_.version != checkpoint_version) fail("unsupported version " + std::to_string(header_.version));
+        if (header_.file_size != file_.size()) fail("truncated");
+        if (sizeof(CheckpointHeader) + std::uint64_t(header_.tensor_count) * sizeof(CheckpointEntry) > file_.size())
+            fail("directory out of bounds");
+        if (checkpoint_checksum(file_.data() + sizeof(header_), file_.size() - sizeof(header_)) != header_.checksum)
+            fail("checksum mismatch");
+        for (std::uint32_t i = 0; i < header_.tensor_count; ++i) {
+            const CheckpointEntry& e = entry(i);
+            if (e.dtype != 0 || e.offset % 8 != 0 || e.offset + e.count * sizeof(double) > file_.size())
+                fail("bad directory entry " + std::to_string(i));
+        }
+    }
+
+    int size() const { return header_.tensor_count; }
+    const CheckpointEntry& entry(int i) const {
+        return reinterpret_cast<const CheckpointEntry*>(file_.data() + sizeof(CheckpointHeader))[i];
+    }
+    std::string name(int i) const { return std::string(entry(i).name, strnlen(entry(i).name, sizeof(entry(i).name))); }
+    const double* data(int i) const { return reinterpret_cast<const double*>(file_.data() + entry(i).offset); }
+
+    // Index of the tensor called `name`, or -1
+    int find(const std::string& name) const {
+        for (int i = 0; i < size(); ++i)
+            if (this->name(i) == name) return i;
+        return -1;
+    }
+
+    // Copy tensor `name` into dst, whose shape must match
+    void read(const std::string& name, Tensor& dst) const {
+        int i = find(name);
+        if (i < 0) fail("no tensor '" + name + "'");
+        const CheckpointEntry& e = entry(i);
+        bool same = int(e.rank) == dst.rank() && e.count == dst.size();
+        for (int d = 0; same && d < dst.rank(); ++d) same = int(e.shape[d]) == dst.dim(d);
+        if (!same) fail("shape mismatch for '" + name + "'");
+        std::memcpy(dst.data(), data(i), e.count * sizeof(double));
+    }
+
+private:
+    std::string path_;
+    MappedFile file_;
+    CheckpointHeader header_;
+
+    [[noreturn]] void fail(const std::string& why) const { throw std::runtime_error(path_ + ": " + why); }
+};
+
+#endif
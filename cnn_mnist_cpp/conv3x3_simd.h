@@ -0,0 +1,197 @@
+#ifndef CONV3X3_SIMD_H
+#define CONV3X3_SIMD_H
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CONV3X3_X86 1
+#endif
+
+// ───────────────────────────
+// Hand-vectorized 3×3, stride-1, unpadded convolution of one image.
+// x is (in_ch, h, w), out is (out_ch, h - 2, w - 2). Each output row is
+// swept in SIMD-wide chunks; for every chunk the nine shifted input
+// vectors are multiplied by broadcast weights and summed in a register.
+// One kernel per ISA level, picked once at startup from CPUID.
+// Sums start from the bias, so results differ from Conv2D's direct loop
+// by rounding only.
+enum class SimdLevel { Scalar, SSE42, AVX2, AVX512 };
+
+using Conv3x3Kernel = void (*)(const double* x, int in_ch, int h, int w,
+                               const double* weights, const double* biases,
+                               int out_ch, double* out);
+
+inline const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE42:  return "sse4.2";
+        case SimdLevel::AVX2:   return "avx2";
+        case SimdLevel::AVX512: return "avx512";
+        default:                return "scalar";
+    }
+}
+
+inline void conv3x3_scalar(const double* x, int in_ch, int h, int w,
+                           const double* weights, const double* biases,
+                           int out_ch, double* out) {
+    int out_h = h - 2, out_w = w - 2;
+    for (int o = 0; o < out_ch; ++o) {
+        double* plane = out + std::size_t(o) * out_h * out_w;
+        for (int c = 0; c < in_ch; ++c) {
+            const double* k = weights + (std::size_t(o) * in_ch + c) * 9;
+            for (int i = 0; i < out_h; ++i) {
+                double* dst = plane + i * out_w;
+                const double* r0 = x + (std::size_t(c) * h + i) * w;
+                const double* r1 = r0 + w;
+                const double* r2 = r1 + w;
+                for (int j = 0; j < out_w; ++j) {
+                    double acc = c == 0 ? biases[o] : dst[j];
+                    acc += r0[j] * k[0] + r0[j + 1] * k[1] + r0[j + 2] * k[2]
+                         + r1[j] * k[3] + r1[j + 1] * k[4] + r1[j + 2] * k[5]
+                         + r2[j] * k[6] + r2[j + 1] * k[7] + r2[j + 2] * k[8];
+                    dst[j] = acc;
+                }
+            }
+        }
+    }
+}
+
+#ifdef CONV3X3_X86
+
+// The SIMD kernels share one shape: per (output channel, input channel)
+// the nine weights are broadcast into registers once, then every output
+// row is swept in register-wide chunks, starting from the bias for the
+// first input channel and from the partial sum for the others.
+
+__attribute__((target("sse4.2")))
+inline void conv3x3_sse42(const double* x, int in_ch, int h, int w,
+                          const double* weights, const double* biases,
+                          int out_ch, double* out) {
+    int out_h = h - 2, out_w = w - 2;
+    for (int o = 0; o < out_ch; ++o) {
+        double* plane = out + std::size_t(o) * out_h * out_w;
+        for (int c = 0; c < in_ch; ++c) {
+            const double* k = weights + (std::size_t(o) * in_ch + c) * 9;
+            __m128d kv[9];
+            for (int t = 0; t < 9; ++t) kv[t] = _mm_set1_pd(k[t]);
+            for (int i = 0; i < out_h; ++i) {
+                double* dst = plane + i * out_w;
+                const double* r = x + (std::size_t(c) * h + i) * w;
+                int j = 0;
+                for (; j + 2 <= out_w; j += 2) {
+                    __m128d acc = c == 0 ? _mm_set1_pd(biases[o]) : _mm_loadu_pd(dst + j);
+                    for (int m = 0; m < 3; ++m)
+                        for (int n = 0; n < 3; ++n)
+                            acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(r + m * w + j + n), kv[m * 3 + n]));
+                    _mm_storeu_pd(dst + j, acc);
+                }
+                for (; j < out_w; ++j) {
+                    double acc = c == 0 ? biases[o] : dst[j];
+                    for (int m = 0; m < 3; ++m)
+                        for (int n = 0; n < 3; ++n)
+                            acc += r[m * w + j + n] * k[m * 3 + n];
+                    dst[j] = acc;
+                }
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+inline void conv3x3_avx2(const double* x, int in_ch, int h, int w,
+                         const double* weights, const double* biases,
+                         int out_ch, double* out) {
+    int out_h = h - 2, out_w = w - 2;
+    for (int o = 0; o < out_ch; ++o) {
+        double* plane = out + std::size_t(o) * out_h * out_w;
+        for (int c = 0; c < in_ch; ++c) {
+            const double* k = weights + (std::size_t(o) * in_ch + c) * 9;
+            __m256d kv[9];
+            for (int t = 0; t < 9; ++t) kv[t] = _mm256_set1_pd(k[t]);
+            for (int i = 0; i < out_h; ++i) {
+                double* dst = plane + i * out_w;
+                const double* r = x + (std::size_t(c) * h + i) * w;
+                int j = 0;
+                for (; j + 4 <= out_w; j += 4) {
+                    __m256d acc = c == 0 ? _mm256_set1_pd(biases[o]) : _mm256_loadu_pd(dst + j);
+                    for (int m = 0; m < 3; ++m)
+                        for (int n = 0; n < 3; ++n)
+                            acc = _mm256_fmadd_pd(_mm256_loadu_pd(r + m * w + j + n), kv[m * 3 + n], acc);
+                    _mm256_storeu_pd(dst + j, acc);
+                }
+                for (; j < out_w; ++j) {
+                    double acc = c == 0 ? biases[o] : dst[j];
+                    for (int m = 0; m < 3; ++m)
+                        for (int n = 0; n < 3; ++n)
+                            acc += r[m * w + j + n] * k[m * 3 + n];
+                    dst[j] = acc;
+                }
+            }
+        }
+    }
+}
+
+// 8 doubles per register; the row tail uses a masked load/store instead
+// of a scalar loop.
+__attribute__((target("avx512f")))
+inline void conv3x3_avx512(const double* x, int in_ch, int h, int w,
+                           const double* weights, const double* biases,
+                           int out_ch, double* out) {
+    int out_h = h - 2, out_w = w - 2;
+    for (int o = 0; o < out_ch; ++o) {
+        double* plane = out + std::size_t(o) * out_h * out_w;
+        for (int c = 0; c < in_ch; ++c) {
+            const double* k = weights + (std::size_t(o) * in_ch + c) * 9;
+            __m512d kv[9];
+            for (int t = 0; t < 9; ++t) kv[t] = _mm512_set1_pd(k[t]);
+            for (int i = 0; i < out_h; ++i) {
+                double* dst = plane + i * out_w;
+                const double* r = x + (std::size_t(c) * h + i) * w;
+                for (int j = 0; j < out_w; j += 8) {
+                    int lanes = out_w - j < 8 ? out_w - j : 8;
+                    __mmask8 mask = static_cast<__mmask8>((1u << lanes) - 1);
+                    __m512d acc = c == 0 ? _mm512_set1_pd(biases[o]) : _mm512_maskz_loadu_pd(mask, dst + j);
+                    for (int m = 0; m < 3; ++m)
+                        for (int n = 0; n < 3; ++n)
+                            acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, r + m * w + j + n), kv[m * 3 + n], acc);
+                    _mm512_mask_storeu_pd(dst + j, mask, acc);
+                }
+            }
+        }
+    }
+}
+
+#endif // CONV3X3_X86
+
+// Highest level this CPU (and OS) supports
+inline SimdLevel detect_simd_level() {
+#ifdef CONV3X3_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return SimdLevel::SSE42;
+#endif
+    return SimdLevel::Scalar;
+}
+
+// Kernel for a given level; levels the build cannot target fall back to scalar
+inline Conv3x3Kernel conv3x3_kernel(SimdLevel level) {
+#ifdef CONV3X3_X86
+    switch (level) {
+        case SimdLevel::AVX512: return conv3x3_avx512;
+        case SimdLevel::AVX2:   return conv3x3_avx2;
+        case SimdLevel::SSE42:  return conv3x3_sse42;
+        default: break;
+    }
+#endif
+    (void)level;
+    return conv3x3_scalar;
+}
+
+// Best kernel for this machine, resolved once
+inline Conv3x3Kernel conv3x3_dispatch() {
+    static const Conv3x3Kernel kernel = conv3x3_kernel(detect_simd_level());
+    return kernel;
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include "data_loader.h"
+#include "binary_dataset.h"
+#include "utils.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+
+// One-time conversion of ../MNIST to the mmap-able binary format:
+//   ../MNIST/{train,test}_images.csv + _labels.csv      → ../MNIST/{train,test}.bin
+//   or, if present, the original IDX files
+//   ../MNIST/{train,t10k}-{images-idx3,labels-idx1}-ubyte
+// Then times loading each split from CSV vs the binary file, cold (page
+// cache dropped for the file) and warm. A model saved in the old text
+// format (trained_model_*.txt) is imported into trained_model.ckpt.
+
+static double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Ask the kernel to forget the file's cached pages so the next read hits disk
+static void drop_page_cache(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+int main() {
+    namespace fs = std::filesystem;
+    const std::string dir = "../MNIST/";
+    const std::pair<std::string, std::string> splits[] = {{"train", "train"}, {"test", "t10k"}};
+
+    for (const auto& [split, idx_prefix] : splits) {
+        std::string images_csv = dir + split + "_images.csv", labels_csv = dir + split + "_labels.csv";
+        std::string images_idx = dir + idx_prefix + "-images-idx3-ubyte";
+        std::string labels_idx = dir + idx_prefix + "-labels-idx1-ubyte";
+        std::string out = dir + split + ".bin";
+
+        auto t0 = std::chrono::steady_clock::now();
+        try {
+            if (fs::exists(images_idx) && fs::exists(labels_idx)) {
+                std::cout << "🔄 Converting " << images_idx << " → " << out << "\n";
+                convert_idx_to_binary(images_idx, labels_idx, out);
+            } else {
+                std::cout << "🔄 Converting " << images_csv << " → " << out << "\n";
+                double error = convert_csv_to_binary(images_csv, labels_csv, out);
+                if (error > 1e-6)
+                    std::cout << "⚠️  Pixels are not multiples of 1/255; stored to the nearest, max error "
+                              << std::scientific << std::setprecision(1) << error << std::defaultfloat << "\n";
+            }
+        } catch (const std::exception& e) {
+            std::cout << "❌ " << e.what() << "\n";
+            return 1;
+        }
+        std::cout << "✅ Wrote " << fs::file_size(out) / 1024 << " KiB in " << std::fixed << std::setprecision(2)
+                  << seconds_since(t0) << " s\n";
+
+        if (!fs::exists(images_csv)) continue;
+        drop_page_cache(images_csv);
+        t0 = std::chrono::steady_clock::now();
+        Dataset from_csv = load_csv_dataset(images_csv, labels_csv);
+        double s_csv = seconds_since(t0);
+
+        drop_page_cache(out);
+        t0 = std::chrono::steady_clock::now();
+        Dataset cold = MappedDataset(out).to_dataset();
+        double s_cold = seconds_since(t0);
+        t0 = std::chrono::steady_clock::now();
+        Dataset warm = MappedDataset(out).to_dataset();
+        double s_warm = seconds_since(t0);
+
+        double max_diff = 0.0;
+        for (std::size_t k = 0; k < from_csv.images.size(); ++k)
+            max_diff = std::max(max_diff, std::abs(from_csv.images[k] - warm.images[k]));
+        std::cout << "⏱️  Load " << from_csv.size() << " " << split << " samples: CSV " << std::setprecision(1)
+                  << s_csv * 1e3 << " ms, binary cold " << s_cold * 1e3 << " ms, warm " << s_warm * 1e3
+                  << " ms (" << std::setprecision(0) << s_csv / s_warm << "× faster), max |Δpixel| "
+                  << std::scientific << std::setprecision(1) << max_diff << std::defaultfloat << "\n";
+        if (warm.labels != from_csv.labels || cold.labels != from_csv.labels) {
+            std::cout << "❌ Labels differ between CSV and " << out << "\n";
+            return 1;
+        }
+    }
+
+    if (fs::exists("trained_model_c1_weights.txt") && !fs::exists("trained_model.ckpt")) {
+        auto t0 = std::chrono::steady_clock::now();
+        CNN model;
+        import_text_model(model, "trained_model");
+        double s_text = seconds_since(t0);
+        save_model(model, "trained_model.ckpt");
+        t0 = std::chrono::steady_clock::now();
+        load_model(model, "trained_model.ckpt");
+        std::cout << "📥 Imported trained_model_*.txt → trained_model.ckpt (" << fs::file_size("trained_model.ckpt") / 1024
+                  << " KiB); load " << std::fixed << std::setprecision(1) << s_text * 1e3 << " ms as text, "
+                  << std::setprecision(2) << seconds_since(t0) * 1e3 << " ms as checkpoint\n";
+    }
+    return 0;
+}
@@ -0,0 +1,234 @@
+#ifndef CSV_READER_H
+#define CSV_READER_H
+
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <cmath>
+
+// ───────────────────────────
+// CsvReader
+// Parallel parser for numeric CSVs with a fixed column count (one sample
+// per line, as MNIST/export_to_csv.py writes them). The file is mmapped and
+// cut into one chunk per thread on line boundaries. A first pass counts
+// the rows in each chunk, which fixes every row's place in the output; the
+// second pass parses each chunk straight into the
+// caller's contiguous rows × cols buffer. Nothing is allocated per line or
+// per cell.
+//
+// Cells that are not a number, and rows with the wrong number of cells,
+// are collected and reported together in one std::runtime_error (count
+// plus the first few, with line and column) instead of being read as 0.
+// Blank lines and a trailing '\r' are ignored.
+class CsvReader {
+public:
+    explicit CsvReader(const std::string& path, int threads = std::max(1u, std::thread::hardware_concurrency()))
+        : path_(path), file_(path), pool_(threads), chunks_(pool_.size()) {
+        const char* text = file_.data();
+        const char* end = text + file_.size();
+
+        // Columns: cells in the first non-blank line
+        for (const char* line = text; line < end && cols_ == 0;) {
+            const char* eol = line_end(line, end);
+            if (trimmed(line, eol) > line) cols_ = 1 + std::count(line, eol, ',');
+            line = eol + (eol < end);
+        }
+
+        // Chunk boundaries: even byte ranges, moved forward to a line start
+        const char* begin = text;
+        for (int t = 0; t < pool_.size(); ++t) {
+            const char* stop = t + 1 == pool_.size() ? end : text + file_.size() * (t + 1) / pool_.size();
+            if (stop < begin) stop = begin;
+            if (stop > text && stop < end && stop[-1] != '\n') {
+                const char* eol = line_end(stop, end);
+                stop = eol < end ? eol + 1 : end;
+            }
+            chunks_[t].begin = begin;
+            chunks_[t].end = stop;
+            begin = chunks_[t].end;
+        }
+
+        auto count = [this](int t) {
+            Chunk& c = chunks_[t];
+            for (const char* line = c.begin; line < c.end;) {
+                const char* eol = line_end(line, c.end);
+                c.rows += trimmed(line, eol) > line;
+                ++c.lines;
+                line = eol + 1;
+            }
+        };
+        pool_.run(count);
+
+        for (Chunk& c : chunks_) {
+            c.first_row = rows_;
+            c.first_line = lines_;
+            rows_ += c.rows;
+            lines_ += c.lines;
+        }
+    }
+
+    std::size_t rows() const { return rows_; }
+    std::size_t cols() const { return cols_; }
+
+    // Parse every cell into out[0 .. rows()·cols()); T is double or int
+    template <typename T>
+    void parse(T* out) { parse_into<T>(out, 1.0); }
+
+    // Parse decimal cells and store them quantized: round(value · scale),
+    // clamped to 0–255 (scale 255 for pixels in [0, 1]). Returns the largest
+    // |value · scale − stored| over all cells, 0 when every one was exact.
+    double parse(std::uint8_t* out, double scale) { return parse_into<double>(out, scale); }
+
+    // Pixels as uint8 p standing for p / 255. Read as [0, 1] first; an
+    // error above half a level means cells were clamped, so the file holds
+    // raw 0–255 values and is read again unscaled. Returns the largest
+    // difference between a cell and the p / 255 stored for it, in [0, 1]
+    // units (0 up to print precision for k/255 data, up to 1/510 for k/256).
+    double parse_pixels(std::uint8_t* out) {
+        double scale = 255.0;
+        double error = parse(out, scale);
+        if (error > 0.5) error = parse(out, scale = 1.0);
+        if (error > 0.5) throw std::runtime_error(path_ + ": pixels outside both [0, 1] and 0–255");
+        return error / scale;
+    }
+
+private:
+    template <typename T, typename Out>
+    double parse_into(Out* out, double scale) {
+        auto work = [&](int t) {
+            Chunk& c = chunks_[t];
+            c.errors = 0;
+            c.max_error = 0.0;
+            c.report.clear();
+            std::size_t row = c.first_row, line_no = c.first_line;
+            for (const char* line = c.begin; line < c.end; ++line_no) {
+                const char* eol = line_end(line, c.end);
+                const char* stop = trimmed(line, eol);
+                if (stop > line) parse_row<T>(c, line, stop, out + row++ * cols_, scale, line_no + 1);
+                line = eol + 1;
+            }
+        };
+        pool_.run(work);
+
+        std::size_t errors = 0;
+        std::string report;
+        double max_error = 0.0;
+        for (const Chunk& c : chunks_) {
+            errors += c.errors;
+            report += c.report;
+            max_error = std::max(max_error, c.max_error);
+        }
+        if (errors)
+            throw std::runtime_error(path_ + ": " + std::to_string(errors) + " malformed cell(s) or row(s)" + report);
+        return max_error;
+    }
+
+    struct Chunk {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        std::size_t rows = 0, lines = 0, first_row = 0, first_line = 0;
+        std::size_t errors = 0;
+        std::string report; // the first few errors of this chunk
+        double max_error = 0.0; // largest quantization error (uint8 output)
+    };
+
+    static constexpr std::size_t max_reported = 5;
+
+    std::string path_;
+    MappedFile file_;
+    ThreadPool pool_;
+    std::vector<Chunk> chunks_;
+    std::size_t rows_ = 0, lines_ = 0, cols_ = 0;
+
+    static const char* line_end(const char* p, const char* end) {
+        const void* nl = std::memchr(p, '\n', end - p);
+        return nl ? static_cast<const char*>(nl) : end;
+    }
+
+    static const char* trimmed(const char* line, const char* eol) {
+        while (eol > line && (eol[-1] == '\r' || eol[-1] == ' ')) --eol;
+        return eol;
+    }
+
+    void malformed(Chunk& c, std::size_t line_no, std::size_t col, const char* cell, const char* cell_end) {
+        if (c.errors++ >= max_reported) return;
+        c.report += "\n  line " + std::to_string(line_no) + ", column " + std::to_string(col + 1) + ": '" +
+                    std::string(cell, std::min<std::size_t>(cell_end - cell, 32)) + "'";
+    }
+
+    // Fast path for plain decimals ("0", "0.8784314", "-12.5"): with at most
+    // 15 significant digits the mantissa and 10^k are exact doubles, so one
+    // division gives the correctly rounded value, bit-identical to strtod
+    // (Clinger's fast path). Anything else (exponents, long mantissas) goes
+    // to std::from_chars, which runs ~4x slower per cell.
+    static bool parse_decimal(const char* p, const char* end, double& out, const char*& next) {
+        static constexpr double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                           1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+        bool negative = p < end && *p == '-';
+        p += negative;
+        std::uint64_t mantissa = 0;
+        int digits = 0, fraction = 0;
+        for (; p < end && unsigned(*p - '0') < 10; ++p, ++digits) mantissa = mantissa * 10 + (*p - '0');
+        if (p < end && *p == '.')
+            for (++p; p < end && unsigned(*p - '0') < 10; ++p, ++digits, ++fraction)
+                mantissa = mantissa * 10 + (*p - '0');
+        if (digits == 0 || digits > 15 || (p < end && (*p == 'e' || *p == 'E'))) return false;
+        double v = double(mantissa) / pow10[fraction];
+        out = negative ? -v : v;
+        next = p;
+        return true;
+    }
+
+    template <typename T, typename Out>
+    void parse_row(Chunk& c, const char* p, const char* stop, Out* row, double scale, std::size_t line_no) {
+        std::size_t col = 0;
+        for (;; ++col) {
+            const char* cell = p;
+            while (p < stop && *p == ' ') ++p;
+            T value{};
+            const char* next = nullptr;
+            bool parsed = false;
+            if constexpr (std::is_same_v<T, double>) parsed = parse_decimal(p, stop, value, next);
+            if (!parsed) {
+                auto [ptr, ec] = std::from_chars(p, stop, value);
+                next = ptr;
+                parsed = ec == std::errc();
+            }
+            const char* cell_end = next;
+            if (!parsed || (next < stop && *next != ',')) {
+                // Slow path: find where the cell ends; spaces after a number are fine
+                cell_end = static_cast<const char*>(std::memchr(cell, ',', stop - cell));
+                if (!cell_end) cell_end = stop;
+                while (next < cell_end && *next == ' ') ++next;
+                if (!parsed || next != cell_end) malformed(c, line_no, col, cell, cell_end);
+            }
+            if (col < cols_) {
+                if constexpr (std::is_same_v<Out, std::uint8_t>) {
+                    double scaled = value * scale;
+                    long stored = std::clamp(std::lround(scaled), 0L, 255L);
+                    row[col] = static_cast<std::uint8_t>(stored);
+                    c.max_error = std::max(c.max_error, std::abs(scaled - stored));
+                } else
+                    row[col] = value;
+            }
+            if (cell_end == stop) break;
+            p = cell_end + 1;
+        }
+        if (col + 1 != cols_) {
+            ++c.errors;
+            if (c.errors <= max_reported)
+                c.report += "\n  line " + std::to_string(line_no) + ": " + std::to_string(col + 1) +
+                            " cells, expected " + std::to_string(cols_);
+        }
+    }
+};
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef DATA_LOADER_H
 #define DATA_LOADER_H
 
+#include "csv_reader.h"
+#include "dataset.h"
 #include <vector>
 #include <string>
 #include <iostream>
@@ -14,42 +16,51 @@ using Image = std::vector<double>; // Keep using double
 using Label = int;
 
 // ─────────────────────────────────────────────────────────────────────────────
-// Load all images from CSV
+// Load all images from CSV (parsed in parallel by CsvReader; malformed
+// cells throw std::runtime_error instead of being read as 0.0)
 std::vector<Image> load_csv_images(const std::string& filename) {
-    std::vector<Image> data;
-    std::ifstream file(filename);
-    std::string line;
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string val;
-        Image row;
-        while (std::getline(ss, val, ',')) {
-            try {
-                row.push_back(std::stod(val)); // Use stod to read directly into double
-            } catch (...) {
-                row.push_back(0.0); // Use 0.0 for double
-            }
-        }
-        data.push_back(row);
-    }
+    CsvReader reader(filename);
+    AlignedVector<double> values(reader.rows() * reader.cols());
+    reader.parse(values.data());
+    std::vector<Image> data(reader.rows());
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i].assign(values.begin() + i * reader.cols(), values.begin() + (i + 1) * reader.cols());
     return data;
 }
 
 // Load all labels from CSV
 std::vector<Label> load_csv_labels(const std::string& filename) {
-    std::vector<Label> labels;
-    std::ifstream file(filename);
-    std::string line;
-    while (std::getline(file, line)) {
-        try {
-            labels.push_back(std::stoi(line));
-        } catch (...) {
-            labels.push_back(0);
-        }
-    }
+    CsvReader reader(filename);
+    std::vector<Label> labels(reader.rows() * reader.cols());
+    reader.parse(labels.data());
     return labels;
 }
 
+// Images and labels straight into one contiguous Dataset, no per-row
+// vectors. packed stores pixels as uint8 p / 255 (CsvReader::parse_pixels,
+// so [0, 1] and raw 0–255 files both work) and, given pixel_error, sets it
+// to the largest difference from the CSV values that introduced
+Dataset load_csv_dataset(const std::string& images_csv, const std::string& labels_csv, bool packed = false,
+                         double* pixel_error = nullptr, int channels = 1, int height = 28, int width = 28) {
+    CsvReader images(images_csv);
+    if (images.cols() != std::size_t(channels) * height * width)
+        throw std::runtime_error(images_csv + ": " + std::to_string(images.cols()) + " values per row, expected " +
+                                 std::to_string(channels * height * width));
+    std::vector<Label> labels = load_csv_labels(labels_csv);
+    if (labels.size() != images.rows())
+        throw std::runtime_error(labels_csv + ": " + std::to_string(labels.size()) + " labels for " +
+                                 std::to_string(images.rows()) + " images");
+    if (packed) {
+        AlignedVector<std::uint8_t> pixels(images.rows() * images.cols());
+        double error = images.parse_pixels(pixels.data());
+        if (pixel_error) *pixel_error = error;
+        return Dataset::packed(std::move(pixels), std::move(labels), channels, height, width);
+    }
+    Dataset d(Tensor4D(static_cast<int>(images.rows()), channels, height, width), std::move(labels));
+    images.parse(d.images.data());
+    return d;
+}
+
 // Balanced subset selection
 void select_balanced_subset(const std::vector<Image>& all_images, const std::vector<Label>& all_labels,
                             std::vector<Image>& selected_images, std::vector<Label>& selected_labels,
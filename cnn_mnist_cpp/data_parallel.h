@@ -0,0 +1,112 @@
+#ifndef DATA_PARALLEL_H
+#define DATA_PARALLEL_H
+
+#include "model.h"
+#include "thread_pool.h"
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+// ───────────────────────────
+// Synchronous data-parallel training step.
+// Each mini-batch is split into one contiguous shard per thread. Every
+// thread owns a full CNN replica (weights plus its own workspace) and runs
+// forward/backward on its shard. The per-thread gradients are weighted by
+// shard size, summed pairwise in a tree (log2(threads) levels), and the
+// model's weights are updated once, by the caller's Optimizer on the
+// calling thread. Replicas pick up the new weights at the start of the
+// next step.
+//
+// Thread 0 works directly on the model passed in, so after step() the
+// model holds the updated weights. The result matches CNN::forward/backward
+// on the whole batch up to summation order.
+class DataParallelTrainer {
+public:
+    DataParallelTrainer(CNN& model, int threads)
+        : model_(model), pool_(threads), shards_(pool_.size()) {
+        for (int t = 1; t < pool_.size(); ++t) {
+            auto replica = std::make_unique<CNN>();
+            replica->fuse_conv_block = model.fuse_conv_block;
+            replica->c1.backend = model.c1.backend;
+            replica->fc1.sparse_below = model.fc1.sparse_below;
+            replica->fc2.sparse_below = model.fc2.sparse_below;
+            replicas_.push_back(std::move(replica));
+        }
+    }
+
+    int threads() const { return pool_.size(); }
+
+    // Plain SGD shorthand for step(x, y, Optimizer::sgd(lr))
+    double step(const Tensor4D& x, const std::vector<int>& y, double lr) {
+        sgd_.lr = lr;
+        return step(x, y, sgd_);
+    }
+
+    // One optimizer step on (x, y); returns the mean loss over the whole batch
+    double step(const Tensor4D& x, const std::vector<int>& y, Optimizer& optimizer) {
+        int batch = x.dim(0);
+        int active = std::min(batch, pool_.size());
+        int first = 0;
+        for (int t = 0; t < pool_.size(); ++t) {
+            Shard& s = shards_[t];
+            s.begin = first;
+            s.size = t < active ? batch / active + (t < batch % active) : 0;
+            first += s.size;
+        }
+
+        auto compute = [&](int t) {
+            Shard& s = shards_[t];
+            CNN& m = replica(t);
+            if (t > 0) copy_weights(model_, m);
+            if (s.size == 0) return;
+            Tensor4D xs = Tensor4D::view(const_cast<double*>(x.sample(s.begin)),
+                                         s.size, x.dim(1), x.dim(2), x.dim(3));
+            s.labels.assign(y.begin() + s.begin, y.begin() + s.begin + s.size);
+            s.loss = m.forward(xs, s.labels);
+            m.backward(); // gradients only; the update happens once, below
+
+            double share = double(s.size) / batch;
+            for (double& g : m.gradients) g *= share;
+        };
+        pool_.run(compute);
+
+        // Tree reduction: at each level thread t adds in thread t + stride
+        for (int stride = 1; stride < active; stride *= 2) {
+            auto reduce = [&](int t) {
+                if (t % (2 * stride) != 0 || t + stride >= active) return;
+                double* dst = replica(t).gradients.data();
+                const double* src = replica(t + stride).gradients.data();
+                for (std::size_t k = 0; k < model_.gradients.size(); ++k) dst[k] += src[k];
+            };
+            pool_.run(reduce);
+        }
+
+        model_.update(optimizer);
+
+        double loss = 0.0;
+        for (int t = 0; t < active; ++t) loss += shards_[t].loss * shards_[t].size / batch;
+        return loss;
+    }
+
+private:
+    struct Shard {
+        int begin = 0, size = 0;
+        double loss = 0.0;
+        std::vector<int> labels;
+    };
+
+    CNN& model_;
+    ThreadPool pool_;
+    std::vector<std::unique_ptr<CNN>> replicas_;
+    std::vector<Shard> shards_;
+    Optimizer sgd_;
+
+    CNN& replica(int t) { return t == 0 ? model_ : *replicas_[t - 1]; }
+
+    static void copy_weights(const CNN& from, CNN& to) {
+        std::copy(from.parameters.begin(), from.parameters.end(), to.parameters.begin());
+        to.weights_changed();
+    }
+};
+
+#endif
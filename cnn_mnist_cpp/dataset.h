@@ -0,0 +1,193 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include "tensor.h"
+#include <vector>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <array>
+
+// ───────────────────────────
+// Dataset
+// All samples stored contiguously, plus their labels, in one of two forms:
+//   - doubles: one (N, C, H, W) tensor, used as is
+//   - packed:  N·C·H·W uint8 pixels (p stands for p / 255), 8× smaller.
+//     gather() dequantizes while copying, so only the batch being
+//     assembled ever exists in floating point.
+// Built once after loading; the training loop never copies it again.
+struct Dataset {
+    Tensor4D images;                     // double storage (empty when packed)
+    AlignedVector<std::uint8_t> pixels;  // packed storage (empty otherwise)
+    std::vector<int> labels;
+    int channels = 1, height = 28, width = 28;
+
+    Dataset() = default;
+    Dataset(Tensor4D x, std::vector<int> y)
+        : images(std::move(x)), labels(std::move(y)), channels(images.dim(1)), height(images.dim(2)),
+          width(images.dim(3)) {}
+
+    static Dataset packed(AlignedVector<std::uint8_t> p, std::vector<int> y, int c = 1, int h = 28, int w = 28) {
+        Dataset d;
+        d.pixels = std::move(p);
+        d.labels = std::move(y);
+        d.channels = c;
+        d.height = h;
+        d.width = w;
+        return d;
+    }
+
+    // From row-per-image vectors (what load_csv_images returns)
+    static Dataset from_rows(const std::vector<std::vector<double>>& rows, const std::vector<int>& y,
+                             int channels = 1, int height = 28, int width = 28) {
+        Dataset d(Tensor4D(static_cast<int>(rows.size()), channels, height, width), y);
+        std::size_t image = d.sample_size();
+        for (std::size_t i = 0; i < rows.size(); ++i)
+            std::copy_n(rows[i].begin(), image, d.images.sample(i));
+        return d;
+    }
+
+    int size() const { return static_cast<int>(labels.size()); }
+    std::size_t sample_size() const { return std::size_t(channels) * height * width; }
+    bool is_packed() const { return !pixels.empty(); }
+    std::size_t bytes() const { return images.size() * sizeof(double) + pixels.size() + labels.size() * sizeof(int); }
+
+    // p / 255.0 for every byte value: exact, without a division per pixel
+    static const double* pixel_values() {
+        static const std::array<double, 256> table = [] {
+            std::array<double, 256> t{};
+            for (int p = 0; p < 256; ++p) t[p] = p / 255.0;
+            return t;
+        }();
+        return table.data();
+    }
+
+    // The same samples quantized to uint8 (values assumed in [0, 1])
+    Dataset pack() const {
+        if (is_packed()) return *this;
+        AlignedVector<std::uint8_t> p(images.size());
+        for (std::size_t k = 0; k < p.size(); ++k)
+            p[k] = static_cast<std::uint8_t>(std::clamp(std::lround(images[k] * 255.0), 0L, 255L));
+        return packed(std::move(p), labels, channels, height, width);
+    }
+
+    // The given samples as a new, contiguous Dataset in the same storage
+    Dataset subset(const std::vector<int>& indices) const {
+        std::size_t image = sample_size();
+        std::vector<int> y(indices.size());
+        for (std::size_t k = 0; k < indices.size(); ++k) y[k] = labels[indices[k]];
+        if (is_packed()) {
+            AlignedVector<std::uint8_t> p(indices.size() * image);
+            for (std::size_t k = 0; k < indices.size(); ++k)
+                std::copy_n(pixels.data() + indices[k] * image, image, p.data() + k * image);
+            return packed(std::move(p), std::move(y), channels, height, width);
+        }
+        Dataset d(Tensor4D(static_cast<int>(indices.size()), channels, height, width), std::move(y));
+        for (std::size_t k = 0; k < indices.size(); ++k)
+            std::copy_n(images.sample(indices[k]), image, d.images.sample(k));
+        return d;
+    }
+
+    // Copy samples idx[0..n) into consecutive rows of dst as doubles,
+    // labels alongside; packed pixels are dequantized on the way
+    void gather(const int* idx, int n, double* dst, int* y) const {
+        std::size_t image = sample_size();
+        if (is_packed()) {
+            const double* value = pixel_values();
+            for (int b = 0; b < n; ++b) {
+                const std::uint8_t* src = pixels.data() + idx[b] * image;
+                double* out = dst + b * image;
+                for (std::size_t p = 0; p < image; ++p) out[p] = value[src[p]];
+                y[b] = labels[idx[b]];
+            }
+            return;
+        }
+        for (int b = 0; b < n; ++b) {
+            std::copy_n(images.sample(idx[b]), image, dst + b * image);
+            y[b] = labels[idx[b]];
+        }
+    }
+};
+
+// Indices of the first per_class samples of each of the ten digits, in
+// order (the rule select_balanced_subset applies to row vectors)
+template <typename LabelAt>
+std::vector<int> balanced_indices(int n, LabelAt label, int per_class) {
+    std::vector<int> picked;
+    int count[10] = {}, full = 0;
+    for (int i = 0; i < n && full < 10; ++i) {
+        int y = label(i);
+        if (y < 0 || y > 9 || count[y] == per_class) continue;
+        picked.push_back(i);
+        if (++count[y] == per_class) ++full;
+    }
+    return picked;
+}
+
+// ───────────────────────────
+// DataLoader
+// Hands out mini-batches of a Dataset in a shuffled order. Shuffling only
+// permutes an index array; each batch is gathered straight from the
+// dataset into one reusable, contiguous batch buffer, so an epoch moves
+// each sample once instead of copying the whole set into a shuffled copy
+// and then again into a fresh per-step tensor. Without shuffling, batches
+// over double storage are views into the dataset itself and nothing is
+// copied at all.
+//
+// The returned batch is only valid until the next call to next().
+struct Batch {
+    Tensor4D x;          // view: loader buffer or dataset rows
+    std::vector<int> y;
+    int size() const { return x.dim(0); }
+};
+
+class DataLoader {
+public:
+    DataLoader(const Dataset& data, int batch_size, bool shuffle = true,
+               std::uint32_t seed = std::random_device{}())
+        : data_(data), batch_size_(batch_size), shuffle_(shuffle), gen_(seed),
+          order_(data.size()) {
+        std::iota(order_.begin(), order_.end(), 0);
+        if (shuffle_ || data.is_packed()) buffer_ = Tensor4D(batch_size_, data.channels, data.height, data.width);
+    }
+
+    int batch_size() const { return batch_size_; }
+    std::size_t steps() const { return (order_.size() + batch_size_ - 1) / batch_size_; }
+    const std::vector<int>& order() const { return order_; }
+
+    // Reshuffle the order (when shuffling) and rewind to the first batch
+    void start_epoch() {
+        if (shuffle_) std::shuffle(order_.begin(), order_.end(), gen_);
+        cursor_ = 0;
+    }
+
+    // Fill `batch` with the next mini-batch; false once the epoch is done
+    bool next(Batch& batch) {
+        if (cursor_ >= order_.size()) return false;
+        int n = static_cast<int>(std::min<std::size_t>(batch_size_, order_.size() - cursor_));
+        const Dataset& d = data_;
+        batch.y.resize(n);
+        if (!buffer_.empty()) {
+            d.gather(order_.data() + cursor_, n, buffer_.data(), batch.y.data());
+            batch.x = Tensor4D::view(buffer_.data(), n, d.channels, d.height, d.width);
+        } else {
+            std::copy_n(d.labels.begin() + cursor_, n, batch.y.begin());
+            batch.x = Tensor4D::view(const_cast<double*>(d.images.sample(cursor_)), n, d.channels, d.height, d.width);
+        }
+        cursor_ += n;
+        return true;
+    }
+
+private:
+    const Dataset& data_;
+    int batch_size_;
+    bool shuffle_;
+    std::mt19937 gen_;
+    std::vector<int> order_;
+    std::size_t cursor_ = 0;
+    Tensor4D buffer_;
+};
+
+#endif
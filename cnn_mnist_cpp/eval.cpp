@@ -1,39 +1,72 @@
 #include "data_loader.h"
+#include "binary_dataset.h"
+#include "streaming.h"
+#include "evaluation.h"
 #include "model.h"
 #include "utils.h"
 #include <fstream>
 #include <iostream>
 #include <iomanip>
 
-int main() {
+// ./eval              classify the test set (../MNIST/test_*.csv) on every core
+// ./eval --threads=N  on N threads
+// ./eval --stream     stream ../MNIST/test.bin instead; its pixels are the
+//                     CSV values rounded to p/255, so results may differ
+int main(int argc, char** argv) {
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    bool stream_bin = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--threads=", 0) == 0) threads = std::max(1, std::stoi(arg.substr(10)));
+        else if (arg == "--stream") stream_bin = true;
+    }
+    if (stream_bin && !std::filesystem::exists("../MNIST/test.bin")) {
+        std::cout << "❌ --stream reads ../MNIST/test.bin; run ./convert first\n";
+        return 1;
+    }
+
     std::cout << "📂 Loading model...\n";
     CNN model;
-    load_model(model, "trained_model");
-
-    std::cout << "📦 Loading test data...\n";
-    std::vector<Image> test_images = load_csv_images("../MNIST/test_images.csv");
-    std::vector<int> test_labels  = load_csv_labels("../MNIST/test_labels.csv");
-
-    // Convert to Tensor4D
-    Tensor4D x_test(test_images.size(), std::vector<std::vector<std::vector<double>>>(
-        1, std::vector<std::vector<double>>(28, std::vector<double>(28, 0.0))));
+    if (std::filesystem::exists("trained_model.ckpt")) {
+        load_model(model, "trained_model.ckpt");
+    } else {
+        std::cout << "📥 No trained_model.ckpt; importing text files trained_model_*.txt\n";
+        import_text_model(model, "trained_model");
+    }
 
-    for (size_t i = 0; i < test_images.size(); ++i)
-        for (int r = 0; r < 28; ++r)
-            for (int c = 0; c < 28; ++c)
-                x_test[i][0][r][c] = test_images[i][r * 28 + c];
+    ShardedEvaluator evaluator(model, threads);
+    Evaluation result;
+    if (stream_bin) {
+        // Windows are read from the file as inference goes, so the test
+        // set never has to fit in memory
+        std::cout << "🌊 Streaming test data from ../MNIST/test.bin...\n";
+        DatasetStream stream("../MNIST/test.bin", 1);
+        std::cout << "🧠 Running inference on " << evaluator.threads() << " threads...\n";
+        result = evaluator.evaluate(stream);
+    } else {
+        std::cout << "📦 Loading test data...\n";
+        Dataset test = load_csv_dataset("../MNIST/test_images.csv", "../MNIST/test_labels.csv");
 
-    std::cout << "🧠 Running inference...\n";
-    std::vector<int> predictions = model.predict(x_test);
+        std::cout << "🧠 Running inference on " << evaluator.threads() << " threads...\n";
+        result = evaluator.evaluate(test);
+    }
+    const std::vector<int>& predictions = result.predictions;
+    const std::vector<int>& test_labels = result.labels;
 
-    // Compute accuracy
-    int correct = 0;
-    for (size_t i = 0; i < predictions.size(); ++i)
-        if (predictions[i] == test_labels[i]) ++correct;
-
-    double accuracy = static_cast<double>(correct) / predictions.size();
+    double accuracy = result.accuracy();
     std::cout << "✅ Accuracy: " << std::fixed << std::setprecision(4) << accuracy * 100.0 << "%\n";
 
+    // Confusion matrix (rows: true digit, columns: predicted) and per-class accuracy
+    std::cout << "🔢 Confusion matrix (true \\ predicted):\n     ";
+    for (int p = 0; p < Evaluation::classes; ++p) std::cout << std::setw(6) << p;
+    std::cout << "\n";
+    for (int t = 0; t < Evaluation::classes; ++t) {
+        std::cout << std::setw(5) << t;
+        for (int p = 0; p < Evaluation::classes; ++p) std::cout << std::setw(6) << result.confusion[t][p];
+        std::cout << "   " << std::setprecision(2) << std::setw(6) << result.class_accuracy(t) * 100.0 << "% of "
+                  << result.class_count(t) << "\n";
+    }
+
     // Save predictions + labels to file
     std::ofstream out("evaluation_results.txt");
     out << "Predicted\tTrue\n";
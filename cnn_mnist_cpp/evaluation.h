@@ -0,0 +1,165 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+#include "model.h"
+#include "streaming.h"
+#include "thread_pool.h"
+#include "workspace.h"
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// ───────────────────────────
+// Evaluation
+// Predictions and labels in sample order, plus the confusion matrix
+// (confusion[true][predicted]) over the ten digits.
+struct Evaluation {
+    static constexpr int classes = 10;
+    std::vector<int> predictions, labels;
+    std::array<std::array<long, classes>, classes> confusion{};
+
+    long total() const {
+        long n = 0;
+        for (const auto& row : confusion)
+            for (long c : row) n += c;
+        return n;
+    }
+    long correct() const {
+        long n = 0;
+        for (int c = 0; c < classes; ++c) n += confusion[c][c];
+        return n;
+    }
+    double accuracy() const { return total() ? double(correct()) / total() : 0.0; }
+
+    // Samples of digit c, and the fraction of them classified as c
+    long class_count(int c) const {
+        long n = 0;
+        for (long k : confusion[c]) n += k;
+        return n;
+    }
+    double class_accuracy(int c) const { return class_count(c) ? double(confusion[c][c]) / class_count(c) : 0.0; }
+};
+
+// ───────────────────────────
+// ShardedEvaluator
+// Classifies a test set on a thread pool. Samples are taken a window at a
+// time (streamed from a file, or read from a Dataset in memory) and each
+// window is cut into shards of `shard` images that the threads claim one
+// after another. Every thread has its own decode buffer, inference
+// workspace and confusion counters; the only shared state is the model's
+// weights, read through the const predict() path, and the prediction
+// array, where each shard writes its own disjoint range. Counters are
+// summed once at the end, so threads never contend while classifying.
+class ShardedEvaluator {
+public:
+    ShardedEvaluator(const CNN& model, int threads = std::max(1u, std::thread::hardware_concurrency()),
+                     int shard = 4 * CNN::infer_chunk)
+        : model_(model), pool_(threads), shard_(std::max(1, shard)), local_(pool_.size()) {}
+
+    int threads() const { return pool_.size(); }
+    int shard() const { return shard_; }
+
+    // Every sample of a dataset file, streamed: only one window of packed
+    // pixels (a few shards per thread) is in memory at a time
+    Evaluation evaluate(DatasetStream& stream) {
+        start(stream.channels(), stream.height(), stream.width(), stream.size());
+        stream.set_window(4 * threads() * shard_);
+        stream.rewind();
+        int first = 0;
+        for (int n; (n = stream.next_window()) > 0; first += n) {
+            auto pixels = [&](int k) { return stream.pixels(k); };
+            auto label = [&](int k) { return stream.label(k); };
+            run_window(first, n, pixels, label);
+        }
+        return finish();
+    }
+
+    // Every sample of an in-memory dataset, packed or double
+    Evaluation evaluate(const Dataset& data) {
+        start(data.channels, data.height, data.width, data.size());
+        auto label = [&](int k) { return data.labels[k]; };
+        if (data.is_packed()) {
+            auto pixels = [&](int k) { return data.pixels.data() + k * data.sample_size(); };
+            run_window(0, data.size(), pixels, label);
+        } else {
+            auto rows = [&](int k) { return data.images.sample(k); };
+            run_window(0, data.size(), rows, label);
+        }
+        return finish();
+    }
+
+private:
+    // Per-thread state, each on its own cache lines
+    struct alignas(64) Local {
+        Workspace ws;
+        AlignedVector<double> decoded;   // one shard of packed pixels as doubles
+        std::array<std::array<long, Evaluation::classes>, Evaluation::classes> confusion{};
+    };
+
+    const CNN& model_;
+    ThreadPool pool_;
+    int shard_;
+    std::vector<Local> local_;
+    Evaluation result_;
+    int channels_ = 1, height_ = 28, width_ = 28;
+
+    void start(int channels, int height, int width, int count) {
+        channels_ = channels;
+        height_ = height;
+        width_ = width;
+        result_ = Evaluation{};
+        result_.predictions.assign(count, 0);
+        result_.labels.assign(count, 0);
+        for (Local& l : local_) l.confusion = {};
+    }
+
+    Evaluation finish() {
+        for (const Local& l : local_)
+            for (int t = 0; t < Evaluation::classes; ++t)
+                for (int p = 0; p < Evaluation::classes; ++p) result_.confusion[t][p] += l.confusion[t][p];
+        return std::move(result_);
+    }
+
+    // Samples [0, n) of the current window are samples [first, first + n)
+    // of the set. sample(k) points at sample k's pixels: uint8 ones are
+    // dequantized into the thread's buffer, double ones are used in place.
+    template <typename Sample, typename Label>
+    void run_window(int first, int n, Sample& sample, Label& label) {
+        std::size_t image = std::size_t(channels_) * height_ * width_;
+        int shards = (n + shard_ - 1) / shard_;
+        std::atomic<int> next{0};
+        auto job = [&](int t) {
+            Local& l = local_[t];
+            for (int s; (s = next.fetch_add(1, std::memory_order_relaxed)) < shards;) {
+                int k0 = s * shard_, m = std::min(shard_, n - k0);
+                Tensor4D x;
+                if constexpr (std::is_same_v<decltype(sample(0)), const std::uint8_t*>) {
+                    if (l.decoded.size() < std::size_t(shard_) * image) l.decoded.assign(std::size_t(shard_) * image, 0.0);
+                    const double* value = Dataset::pixel_values();
+                    for (int k = 0; k < m; ++k) {
+                        const std::uint8_t* src = sample(k0 + k);
+                        double* out = l.decoded.data() + k * image;
+                        for (std::size_t p = 0; p < image; ++p) out[p] = value[src[p]];
+                    }
+                    x = Tensor4D::view(l.decoded.data(), m, channels_, height_, width_);
+                } else {
+                    x = Tensor4D::view(const_cast<double*>(sample(k0)), m, channels_, height_, width_);
+                }
+
+                int* predicted = result_.predictions.data() + first + k0;
+                model_.predict(x, predicted, l.ws);
+                for (int k = 0; k < m; ++k) {
+                    int y = label(k0 + k);
+                    result_.labels[first + k0 + k] = y;
+                    if (y >= 0 && y < Evaluation::classes) ++l.confusion[y][predicted[k]];
+                }
+            }
+        };
+        pool_.run(job);
+    }
+};
+
+#endif
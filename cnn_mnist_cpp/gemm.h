@@ -0,0 +1,186 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "tensor.h"
+#include <algorithm>
+#include <cstddef>
+
+// ───────────────────────────
+// Cache-blocked, register-tiled GEMM on row-major doubles:
+//   C (M×N) = op(A) (M×K) · op(B) (K×N)      or  C += ...
+// op() is an optional transpose, folded into packing so the micro-kernel
+// always streams contiguous MR- and NR-wide panels.
+//
+// Blocking follows the usual Goto layout: a KC×NC slice of B is packed
+// once per (pc, jc) and stays in L2/L3, an MC×KC block of A is packed into
+// L2, and the MR×NR micro-tile of C lives in registers.
+namespace gemm_detail {
+
+constexpr int MR = 4;
+constexpr int NR = 8;
+constexpr int MC = 128;
+constexpr int KC = 256;
+constexpr int NC = 2048;
+
+// Per-thread packing scratch of at least n doubles: sized by the largest
+// block a thread has packed so far, grown on demand and reused afterwards
+inline double* scratch(AlignedVector<double>& buf, std::size_t n) {
+    if (buf.size() < n) buf.assign(n, 0.0);
+    return buf.data();
+}
+inline double* scratch_a(std::size_t n) {
+    thread_local AlignedVector<double> buf;
+    return scratch(buf, n);
+}
+inline double* scratch_b(std::size_t n) {
+    thread_local AlignedVector<double> buf;
+    return scratch(buf, n);
+}
+
+// Doubles a packed A block (up to MC×KC) and B slice (up to KC×NC) take
+// for an M×N×K product, rows/columns padded to whole panels
+inline std::size_t packed_a_size(int M, int K) {
+    return std::size_t((std::min(MC, M) + MR - 1) / MR * MR) * std::min(KC, K);
+}
+inline std::size_t packed_b_slice_size(int N, int K) {
+    return std::size_t((std::min(NC, N) + NR - 1) / NR * NR) * std::min(KC, K);
+}
+
+inline double load(const double* m, int ld, bool trans, int r, int c) {
+    return trans ? m[std::size_t(c) * ld + r] : m[std::size_t(r) * ld + c];
+}
+
+// A block (mc×kc) → MR-row panels, p-major inside each panel, zero-padded
+inline void pack_a(const double* A, int lda, bool trans, int i0, int p0, int mc, int kc, double* dst) {
+    for (int i = 0; i < mc; i += MR) {
+        for (int p = 0; p < kc; ++p)
+            for (int ii = 0; ii < MR; ++ii)
+                *dst++ = (i + ii < mc) ? load(A, lda, trans, i0 + i + ii, p0 + p) : 0.0;
+    }
+}
+
+// B block (kc×nc) → NR-column panels, p-major inside each panel, zero-padded
+inline void pack_b(const double* B, int ldb, bool trans, int p0, int j0, int kc, int nc, double* dst) {
+    for (int j = 0; j < nc; j += NR) {
+        if (!trans && j + NR <= nc) {
+            for (int p = 0; p < kc; ++p) {
+                const double* src = B + std::size_t(p0 + p) * ldb + j0 + j;
+                for (int jj = 0; jj < NR; ++jj) *dst++ = src[jj];
+            }
+            continue;
+        }
+        for (int p = 0; p < kc; ++p)
+            for (int jj = 0; jj < NR; ++jj)
+                *dst++ = (j + jj < nc) ? load(B, ldb, trans, p0 + p, j0 + j + jj) : 0.0;
+    }
+}
+
+// MR×NR register tile: acc = a_panel · b_panel, then stored or added into C
+inline void micro_kernel(int kc, const double* __restrict a, const double* __restrict b,
+                         double* C, int ldc, int mr, int nr, bool accumulate) {
+    double acc[MR][NR] = {};
+    for (int p = 0; p < kc; ++p) {
+        for (int i = 0; i < MR; ++i) {
+            double av = a[p * MR + i];
+            for (int j = 0; j < NR; ++j)
+                acc[i][j] += av * b[p * NR + j];
+        }
+    }
+    for (int i = 0; i < mr; ++i) {
+        double* c = C + std::size_t(i) * ldc;
+        if (accumulate)
+            for (int j = 0; j < nr; ++j) c[j] += acc[i][j];
+        else
+            for (int j = 0; j < nr; ++j) c[j] = acc[i][j];
+    }
+}
+
+// C block rows ic.., columns jc.. from a packed kc×nc slice of B
+inline void macro_kernel(bool trans_a, int M, int pc, int kc, int jc, int nc,
+                         const double* A, int lda, const double* pb, double* pa,
+                         double* C, int ldc, bool acc) {
+    for (int ic = 0; ic < M; ic += MC) {
+        int mc = std::min(MC, M - ic);
+        pack_a(A, lda, trans_a, ic, pc, mc, kc, pa);
+
+        for (int jr = 0; jr < nc; jr += NR) {
+            int nr = std::min(NR, nc - jr);
+            for (int ir = 0; ir < mc; ir += MR) {
+                int mr = std::min(MR, mc - ir);
+                micro_kernel(kc, pa + std::size_t(ir) * kc, pb + std::size_t(jr) * kc,
+                             C + std::size_t(ic + ir) * ldc + jc + jr, ldc, mr, nr, acc);
+            }
+        }
+    }
+}
+
+inline bool trivial(int M, int N, int K, double* C, int ldc, bool accumulate) {
+    if (M <= 0 || N <= 0) return true;
+    if (K > 0) return false;
+    if (!accumulate)
+        for (int i = 0; i < M; ++i) std::fill_n(C + std::size_t(i) * ldc, N, 0.0);
+    return true;
+}
+
+} // namespace gemm_detail
+
+// lda/ldb/ldc are the row strides of A, B and C as stored (before op())
+inline void gemm(bool trans_a, bool trans_b, int M, int N, int K,
+                 const double* A, int lda, const double* B, int ldb,
+                 double* C, int ldc, bool accumulate = false) {
+    using namespace gemm_detail;
+    if (trivial(M, N, K, C, ldc, accumulate)) return;
+
+    double* pa = scratch_a(packed_a_size(M, K));
+    double* pb = scratch_b(packed_b_slice_size(N, K));
+
+    for (int jc = 0; jc < N; jc += NC) {
+        int nc = std::min(NC, N - jc);
+        for (int pc = 0; pc < K; pc += KC) {
+            int kc = std::min(KC, K - pc);
+            pack_b(B, ldb, trans_b, pc, jc, kc, nc, pb);
+            macro_kernel(trans_a, M, pc, kc, jc, nc, A, lda, pb, pa, C, ldc, accumulate || pc > 0);
+        }
+    }
+}
+
+// ───────────────────────────
+// Pre-packed B: a matrix used as the right operand many times (Dense
+// weights) is packed once into the exact panel order gemm() would build,
+// slice after slice, and the per-call packing of B is skipped.
+inline std::size_t packed_b_size(int K, int N) {
+    int padded_n = (N + gemm_detail::NR - 1) / gemm_detail::NR * gemm_detail::NR;
+    return std::size_t(K) * padded_n;
+}
+
+// dst holds packed_b_size(K, N) doubles
+inline void pack_gemm_b(bool trans_b, int K, int N, const double* B, int ldb, double* dst) {
+    using namespace gemm_detail;
+    for (int jc = 0; jc < N; jc += NC) {
+        int nc = std::min(NC, N - jc);
+        for (int pc = 0; pc < K; pc += KC) {
+            int kc = std::min(KC, K - pc);
+            pack_b(B, ldb, trans_b, pc, jc, kc, nc, dst);
+            dst += std::size_t(kc) * ((nc + NR - 1) / NR * NR);
+        }
+    }
+}
+
+// C = op(A) · B with B already packed by pack_gemm_b(·, K, N, ...)
+inline void gemm_packed(bool trans_a, int M, int N, int K, const double* A, int lda,
+                        const double* packed_b, double* C, int ldc, bool accumulate = false) {
+    using namespace gemm_detail;
+    if (trivial(M, N, K, C, ldc, accumulate)) return;
+
+    double* pa = scratch_a(packed_a_size(M, K));
+    for (int jc = 0; jc < N; jc += NC) {
+        int nc = std::min(NC, N - jc);
+        for (int pc = 0; pc < K; pc += KC) {
+            int kc = std::min(KC, K - pc);
+            macro_kernel(trans_a, M, pc, kc, jc, nc, A, lda, packed_b, pa, C, ldc, accumulate || pc > 0);
+            packed_b += std::size_t(kc) * ((nc + NR - 1) / NR * NR);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef HOGWILD_H
+#define HOGWILD_H
+
+#include "model.h"
+#include "dataset.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+// ───────────────────────────
+// Hogwild! asynchronous SGD (opt-in).
+// The weights live in one shared array of relaxed atomics. Worker threads
+// claim the next mini-batch from a shared cursor over the epoch's sample
+// order. For each batch a worker snapshots the shared weights into its own
+// CNN replica, runs forward/backward, and writes w -= lr·g straight back.
+// There are no locks and no barrier between steps. Concurrent updates to
+// the same weight may overwrite each other or mix weights from different
+// steps; for sparse-ish SGD on a model this size that noise is harmless.
+// The update is plain SGD: optimizer state (momentum, Adam moments) would
+// be shared and raced on as well.
+//
+// Relaxed loads and stores compile to plain moves on x86; they only make
+// the races well-defined.
+class HogwildTrainer {
+public:
+    HogwildTrainer(CNN& model, int threads) : model_(model), pool_(threads) {
+        shared_.reset(new std::atomic<double>[model.parameters.size()]);
+        pull(model);
+
+        for (int t = 0; t < pool_.size(); ++t) {
+            Worker w;
+            w.model = std::make_unique<CNN>();
+            w.model->fuse_conv_block = model.fuse_conv_block;
+            w.model->c1.backend = model.c1.backend;
+            w.model->fc1.sparse_below = model.fc1.sparse_below;
+            w.model->fc2.sparse_below = model.fc2.sparse_below;
+            workers_.push_back(std::move(w));
+        }
+    }
+
+    int threads() const { return pool_.size(); }
+
+    // One pass over `data` in `order`, batch_size samples at a time; returns
+    // the mean batch loss. The model holds the final weights afterwards.
+    double epoch(const Dataset& data, const std::vector<int>& order, int batch_size, double lr) {
+        std::atomic<std::size_t> cursor{0};
+        std::size_t total = order.size();
+        int c = data.channels, h = data.height, w = data.width;
+        std::size_t image = data.sample_size();
+
+        auto work = [&](int t) {
+            Worker& wk = workers_[t];
+            CNN& m = *wk.model;
+            if (wk.batch.size() != batch_size * image)
+                wk.batch = Tensor4D(batch_size, c, h, w);
+            wk.loss = 0.0;
+            wk.steps = 0;
+
+            for (;;) {
+                std::size_t begin = cursor.fetch_add(batch_size, std::memory_order_relaxed);
+                if (begin >= total) break;
+                int n = static_cast<int>(std::min<std::size_t>(batch_size, total - begin));
+
+                wk.labels.resize(n);
+                data.gather(order.data() + begin, n, wk.batch.data(), wk.labels.data());
+                Tensor4D xb = Tensor4D::view(wk.batch.data(), n, c, h, w);
+
+                load_shared(m);
+                wk.loss += m.forward(xb, wk.labels);
+                m.backward(); // gradients only
+                apply_shared(m, lr);
+                ++wk.steps;
+            }
+        };
+        pool_.run(work);
+
+        load_shared(model_);
+        double loss = 0.0;
+        long steps = 0;
+        for (const Worker& wk : workers_) {
+            loss += wk.loss;
+            steps += wk.steps;
+        }
+        return steps ? loss / steps : 0.0;
+    }
+
+    // Re-read the model's weights into the shared copy (after editing them)
+    void pull(const CNN& model) {
+        for (std::size_t k = 0; k < model.parameters.size(); ++k)
+            shared_[k].store(model.parameters[k], std::memory_order_relaxed);
+    }
+
+private:
+    struct Worker {
+        std::unique_ptr<CNN> model;
+        Tensor4D batch;
+        std::vector<int> labels;
+        double loss = 0.0;
+        long steps = 0;
+    };
+
+    CNN& model_;
+    ThreadPool pool_;
+    std::unique_ptr<std::atomic<double>[]> shared_;
+    std::vector<Worker> workers_;
+
+    void load_shared(CNN& m) {
+        for (std::size_t k = 0; k < m.parameters.size(); ++k)
+            m.parameters[k] = shared_[k].load(std::memory_order_relaxed);
+        m.weights_changed();
+    }
+
+    void apply_shared(const CNN& m, double lr) {
+        for (std::size_t k = 0; k < m.gradients.size(); ++k) {
+            double v = shared_[k].load(std::memory_order_relaxed);
+            shared_[k].store(v - lr * m.gradients[k], std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef IM2COL_H
+#define IM2COL_H
+
+#include <algorithm>
+#include <cstddef>
+
+// ───────────────────────────
+// im2col for a stride-1, unpadded convolution of one image.
+// x is (channels, h, w); col is (channels·k·k) × (out_h·out_w), row
+// (c·k + m)·k + n holding x[c][i + m][j + n] at column i·out_w + j. The row
+// order matches Conv2D's (out, in, k, k) weights, so the weights are the
+// (out × in·k·k) left-hand matrix as-is.
+inline void im2col(const double* x, int channels, int h, int w, int k, double* col) {
+    int out_h = h - k + 1;
+    int out_w = w - k + 1;
+    for (int c = 0; c < channels; ++c)
+        for (int m = 0; m < k; ++m)
+            for (int n = 0; n < k; ++n) {
+                double* row = col + std::size_t((c * k + m) * k + n) * out_h * out_w;
+                for (int i = 0; i < out_h; ++i)
+                    std::copy_n(x + (std::size_t(c) * h + i + m) * w + n, out_w, row + i * out_w);
+            }
+}
+
+// Adjoint of im2col: scatter-add each patch row back into a (channels, h, w)
+// image. dx is overwritten.
+inline void col2im(const double* col, int channels, int h, int w, int k, double* dx) {
+    int out_h = h - k + 1;
+    int out_w = w - k + 1;
+    std::fill_n(dx, std::size_t(channels) * h * w, 0.0);
+    for (int c = 0; c < channels; ++c)
+        for (int m = 0; m < k; ++m)
+            for (int n = 0; n < k; ++n) {
+                const double* row = col + std::size_t((c * k + m) * k + n) * out_h * out_w;
+                for (int i = 0; i < out_h; ++i) {
+                    double* dst = dx + (std::size_t(c) * h + i + m) * w + n;
+                    const double* src = row + i * out_w;
+                    for (int j = 0; j < out_w; ++j) dst[j] += src[j];
+                }
+            }
+}
+
+#endif
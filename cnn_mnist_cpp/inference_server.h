@@ -0,0 +1,384 @@
+#ifndef INFERENCE_SERVER_H
+#define INFERENCE_SERVER_H
+
+#include "model.h"
+#include "dataset.h"
+#include "workspace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// ───────────────────────────
+// Socket helpers: whole buffers or nothing (false on EOF or error)
+inline bool read_full(int fd, void* buf, std::size_t bytes) {
+    char* p = static_cast<char*>(buf);
+    while (bytes > 0) {
+        ssize_t got = ::recv(fd, p, bytes, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        p += got;
+        bytes -= got;
+    }
+    return true;
+}
+
+inline bool write_full(int fd, const void* buf, std::size_t bytes) {
+    const char* p = static_cast<const char*>(buf);
+    while (bytes > 0) {
+        ssize_t put = ::send(fd, p, bytes, MSG_NOSIGNAL);
+        if (put < 0 && errno == EINTR) continue;
+        if (put <= 0) return false;
+        p += put;
+        bytes -= put;
+    }
+    return true;
+}
+
+inline sockaddr_un unix_address(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) throw std::runtime_error("Socket path too long: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+// ───────────────────────────
+// DynamicBatcher
+// Turns single-image requests from many threads into batched predict()
+// calls. A request waits in a queue; a worker takes the queue as soon as
+// it holds max_batch images, or once its oldest request has waited
+// max_delay, whichever comes first. Under light load a request pays at
+// most max_delay of extra latency; under heavy load batches fill at once
+// and the workers run full-size batches back to back.
+//
+// Workers share the model read-only (the const infer() path) and each
+// owns its batch buffer and workspace, so while one runs a batch the
+// next can already be collecting.
+struct BatchingOptions {
+    int max_batch = CNN::infer_chunk;
+    int max_delay_us = 2000;
+    int workers = std::max(1u, std::thread::hardware_concurrency());
+};
+
+class DynamicBatcher {
+public:
+    DynamicBatcher(const CNN& model, BatchingOptions options = {}, int channels = 1, int height = 28, int width = 28)
+        : model_(model), options_(options), channels_(channels), height_(height), width_(width) {
+        options_.max_batch = std::max(1, options_.max_batch);
+        options_.workers = std::max(1, options_.workers);
+        for (int t = 0; t < options_.workers; ++t) workers_.emplace_back([this] { worker_loop(); });
+    }
+
+    // Finishes every queued request, then stops the workers
+    ~DynamicBatcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_.notify_all();
+        for (std::thread& w : workers_) w.join();
+    }
+
+    DynamicBatcher(const DynamicBatcher&) = delete;
+    DynamicBatcher& operator=(const DynamicBatcher&) = delete;
+
+    std::size_t sample_size() const { return std::size_t(channels_) * height_ * width_; }
+    const BatchingOptions& options() const { return options_; }
+
+    // Class of one packed image (sample_size() bytes, p stands for p / 255);
+    // blocks until its batch has run. Safe to call from any thread.
+    int classify(const std::uint8_t* pixels) {
+        Request request;
+        request.pixels = pixels;
+        request.arrived = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stopping_) throw std::runtime_error("DynamicBatcher: stopped");
+        queue_.push_back(&request);
+        if (queue_.size() == 1) work_.notify_one();
+        else if (queue_.size() == std::size_t(options_.max_batch)) work_.notify_all(); // a full batch: no more waiting
+        request.finished.wait(lock, [&] { return request.done; });
+        return request.result;
+    }
+
+    long requests() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return requests_;
+    }
+    long batches() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return batches_;
+    }
+    double mean_batch() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return batches_ ? double(requests_) / batches_ : 0.0;
+    }
+
+private:
+    struct Request {
+        const std::uint8_t* pixels = nullptr;
+        std::chrono::steady_clock::time_point arrived;
+        std::condition_variable finished;
+        bool done = false;
+        int result = -1;
+    };
+
+    const CNN& model_;
+    BatchingOptions options_;
+    int channels_, height_, width_;
+    std::vector<std::thread> workers_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_;
+    std::deque<Request*> queue_;
+    bool stopping_ = false;
+    long requests_ = 0, batches_ = 0;
+
+    void worker_loop() {
+        std::size_t image = sample_size();
+        AlignedVector<double> x_buf(std::size_t(options_.max_batch) * image);
+        std::vector<int> predictions(options_.max_batch);
+        std::vector<Request*> batch;
+        batch.reserve(options_.max_batch);
+        Workspace ws;
+        const double* value = Dataset::pixel_values();
+        auto max_delay = std::chrono::microseconds(options_.max_delay_us);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            work_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return; // stopping, nothing left
+            // Hold the batch open until it is full or its oldest request is due
+            while (!stopping_ && !queue_.empty() && queue_.size() < std::size_t(options_.max_batch) &&
+                   std::chrono::steady_clock::now() < queue_.front()->arrived + max_delay)
+                work_.wait_until(lock, queue_.front()->arrived + max_delay);
+            if (queue_.empty()) continue; // another worker took it
+
+            int n = static_cast<int>(std::min<std::size_t>(queue_.size(), options_.max_batch));
+            batch.assign(queue_.begin(), queue_.begin() + n);
+            queue_.erase(queue_.begin(), queue_.begin() + n);
+            if (!queue_.empty()) work_.notify_one(); // the rest starts the next batch
+            lock.unlock();
+
+            for (int b = 0; b < n; ++b) {
+                const std::uint8_t* src = batch[b]->pixels;
+                double* out = x_buf.data() + b * image;
+                for (std::size_t p = 0; p < image; ++p) out[p] = value[src[p]];
+            }
+            Tensor4D x = Tensor4D::view(x_buf.data(), n, channels_, height_, width_);
+            model_.predict(x, predictions.data(), ws);
+
+            lock.lock();
+            for (int b = 0; b < n; ++b) {
+                batch[b]->result = predictions[b];
+                batch[b]->done = true;
+                batch[b]->finished.notify_one();
+            }
+            requests_ += n;
+            ++batches_;
+        }
+    }
+};
+
+// ───────────────────────────
+// InferenceServer
+// Long-running classifier on a Unix domain socket: the model is loaded
+// once and every connection's requests go through one DynamicBatcher.
+// The protocol is fixed-size frames, no headers:
+//
+//   client → server   one image, sample_size() uint8 pixels (p / 255)
+//   server → client   one byte, its class
+//
+// A connection may send any number of images, one after another. Each
+// connection is served by its own thread, so concurrent clients are what
+// fill the batches.
+class InferenceServer {
+public:
+    InferenceServer(const CNN& model, const std::string& socket_path, BatchingOptions options = {})
+        : path_(socket_path), batcher_(model, options) {
+        sockaddr_un addr = unix_address(path_);
+        listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd_ < 0) throw std::runtime_error("Cannot create socket");
+        ::unlink(path_.c_str()); // a stale socket left by an earlier run
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listen_fd_, 128) != 0) {
+            ::close(listen_fd_);
+            throw std::runtime_error("Cannot listen on " + path_);
+        }
+    }
+
+    ~InferenceServer() {
+        stop();
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return connections_.empty(); });
+        lock.unlock();
+        ::close(listen_fd_);
+        ::unlink(path_.c_str());
+    }
+
+    InferenceServer(const InferenceServer&) = delete;
+    InferenceServer& operator=(const InferenceServer&) = delete;
+
+    const DynamicBatcher& batcher() const { return batcher_; }
+    long connections_served() const { return served_; }
+
+    // Accept connections until stop(); returns only then. Running out of
+    // descriptors or kernel memory is waited out 10 ms at a time, any other
+    // accept() failure is thrown.
+    void serve() {
+        while (!stopping_) {
+            int fd = ::accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) {
+                int error = errno;
+                if (stopping_ || error == EINTR || error == ECONNABORTED) continue;
+                if (error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    continue;
+                }
+                throw std::runtime_error(std::string("InferenceServer: accept failed: ") + std::strerror(error));
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                ::close(fd);
+                break;
+            }
+            connections_.push_back(fd);
+            ++served_;
+            std::thread([this, fd] { handle(fd); }).detach();
+        }
+    }
+
+    // Stop accepting and hang up on open connections; safe from any thread
+    // (not from a signal handler)
+    void stop() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        stopping_ = true;
+        ::shutdown(listen_fd_, SHUT_RDWR);
+        for (int fd : connections_) ::shutdown(fd, SHUT_RDWR);
+    }
+
+private:
+    std::string path_;
+    DynamicBatcher batcher_;
+    int listen_fd_ = -1;
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    std::vector<int> connections_;   // open client sockets
+    std::atomic<bool> stopping_{false};
+    std::atomic<long> served_{0};
+
+    void handle(int fd) {
+        std::vector<std::uint8_t> image(batcher_.sample_size());
+        while (read_full(fd, image.data(), image.size())) {
+            std::uint8_t label = static_cast<std::uint8_t>(batcher_.classify(image.data()));
+            if (!write_full(fd, &label, 1)) break;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        ::close(fd);
+        connections_.erase(std::find(connections_.begin(), connections_.end(), fd));
+        idle_.notify_all();
+    }
+};
+
+// ───────────────────────────
+// InferenceClient
+// One connection to an InferenceServer.
+class InferenceClient {
+public:
+    explicit InferenceClient(const std::string& socket_path) {
+        sockaddr_un addr = unix_address(socket_path);
+        fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd_ < 0 || ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            if (fd_ >= 0) ::close(fd_);
+            throw std::runtime_error("Cannot connect to " + socket_path);
+        }
+    }
+    ~InferenceClient() { ::close(fd_); }
+
+    InferenceClient(const InferenceClient&) = delete;
+    InferenceClient& operator=(const InferenceClient&) = delete;
+
+    // Class of one packed image of `bytes` pixels
+    int classify(const std::uint8_t* pixels, std::size_t bytes) {
+        std::uint8_t label;
+        if (!write_full(fd_, pixels, bytes) || !read_full(fd_, &label, 1))
+            throw std::runtime_error("InferenceClient: connection lost");
+        return label;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+// ───────────────────────────
+// Load generator
+// `clients` connections, each sending `requests` images of a packed
+// Dataset one at a time (the next as soon as the last is answered), all
+// at once. Latency is measured per request at the client.
+struct LoadReport {
+    long requests = 0, correct = 0;
+    double seconds = 0.0;
+    double p50 = 0.0, p99 = 0.0, max = 0.0; // latency, seconds
+    double throughput() const { return seconds > 0 ? requests / seconds : 0.0; }
+};
+
+LoadReport generate_load(const std::string& socket_path, const Dataset& images, int clients, int requests) {
+    if (!images.is_packed() || images.size() == 0) throw std::runtime_error("generate_load: needs a packed dataset");
+    std::vector<std::vector<double>> latencies(clients);
+    std::vector<long> correct(clients, 0);
+    std::vector<std::string> errors(clients);
+    std::size_t image = images.sample_size();
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c)
+        threads.emplace_back([&, c] {
+            try {
+                InferenceClient client(socket_path);
+                latencies[c].reserve(requests);
+                for (int r = 0; r < requests; ++r) {
+                    int i = static_cast<int>((long(c) * requests + r) % images.size());
+                    auto start = std::chrono::steady_clock::now();
+                    int label = client.classify(images.pixels.data() + i * image, image);
+                    latencies[c].push_back(
+                        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+                    correct[c] += label == images.labels[i];
+                }
+            } catch (const std::exception& e) {
+                errors[c] = e.what();
+            }
+        });
+    for (std::thread& t : threads) t.join();
+
+    LoadReport report;
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    for (const std::string& e : errors)
+        if (!e.empty()) throw std::runtime_error(e);
+    std::vector<double> all;
+    for (int c = 0; c < clients; ++c) {
+        all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+        report.correct += correct[c];
+    }
+    report.requests = static_cast<long>(all.size());
+    if (all.empty()) return report;
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double q) { return all[std::min(all.size() - 1, std::size_t(q * all.size()))]; };
+    report.p50 = percentile(0.50);
+    report.p99 = percentile(0.99);
+    report.max = all.back();
+    return report;
+}
+
+#endif
@@ -1,14 +1,18 @@
 #ifndef LAYERS_H
 #define LAYERS_H
 
+#include "tensor.h"
+#include "workspace.h"
+#include "gemm.h"
+#include "im2col.h"
+#include "conv3x3_simd.h"
+#include "winograd.h"
 #include <vector>
 #include <random>
 #include <cmath>
 #include <algorithm>
 #include <iostream>
-
-using Tensor4D = std::vector<std::vector<std::vector<std::vector<double>>>>; // Use double
-using Matrix = std::vector<std::vector<double>>; // Use double
+#include <cstdint>
 
 double randn(double stddev) { // Use double
     static std::mt19937 gen(std::random_device{}());
@@ -16,43 +20,123 @@ double randn(double stddev) { // Use double
     return dist(gen) * stddev;
 }
 
+// Every layer follows the same protocol: bind() carves the layer's output,
+// mask and gradient buffers out of a Workspace for a given input shape,
+// forward()/backward() then fill those buffers and return references to
+// them. A returned reference stays valid until the next bind().
+// backward() only computes gradients; parameter gradients (dw/db,
+// d_weights/d_biases) are shaped like the parameters, outlive bind(), and
+// are applied by an Optimizer (optimizer.h).
+//
+// infer() is the inference-only counterpart of forward(): const, it writes
+// into buffers the caller passes in and records nothing for backward (no
+// input pointer, masks or argmax), so several threads may run it on the
+// same layer at once as long as nobody is changing the weights.
+
 // ───────────────────────────
 // Conv2D
+// Direct: the reference 7-deep loop.
+// Im2col: lower each image to a patch matrix and run one blocked GEMM.
+// Simd3x3: CPUID-dispatched 3×3 kernel (conv3x3_simd.h); forward only,
+//          other kernel sizes fall back to Im2col. Backward uses Im2col.
+// Winograd: F(2×2, 3×3) forward and input gradient (winograd.h), with the
+//          filter transforms cached until the weights change; dW uses
+//          Im2col. Other kernel sizes fall back to Im2col.
+enum class ConvBackend { Direct, Im2col, Simd3x3, Winograd };
+
 class Conv2D {
 public:
     int in_channels, out_channels, kernel_size;
-    std::vector<std::vector<std::vector<std::vector<double>>>> weights; // Use double
-    std::vector<double> biases; // Use double
-
-    Tensor4D input;
+    Tensor4D weights;            // (out_ch, in_ch, k, k)
+    Tensor biases;               // (out_ch)
+    ConvBackend backend;
+    bool needs_input_grad = true;    // false for a first layer: skip dX entirely
+
+    const Tensor4D* input = nullptr; // caller's batch, must outlive backward()
+    Tensor4D output, d_input;
+    Tensor4D dw;                     // dL/dweights from the last backward()
+    Tensor db;                       // dL/dbiases
+    Matrix col, d_col;               // im2col patches of one image and their gradient
+    Tensor wino_v;                   // Winograd input-tile transforms of one image
+
+    // Winograd filter transforms: forward (out, in, 16) and, for the input
+    // gradient, rotated and transposed (in, out, 16). Call weights_changed()
+    // after writing `weights`.
+    Tensor wino_u, wino_u_back;
+    bool wino_stale = true;
 
     Conv2D(int in_ch, int out_ch, int k)
-        : in_channels(in_ch), out_channels(out_ch), kernel_size(k) {
+        : in_channels(in_ch), out_channels(out_ch), kernel_size(k),
+          weights(out_ch, in_ch, k, k), biases(out_ch),
+          backend(k == 3 ? ConvBackend::Simd3x3 : ConvBackend::Im2col),
+          dw(out_ch, in_ch, k, k), db(out_ch) {
         double stddev = std::sqrt(2.0 / (in_ch * k * k)); // Use double
-        weights.resize(out_ch, std::vector<std::vector<std::vector<double>>>( // Use double
-                                  in_ch, std::vector<std::vector<double>>( // Use double
-                                             k, std::vector<double>(k)))); // Use double
-        biases.resize(out_ch, 0.0); // Use double
-
-        for (int o = 0; o < out_ch; ++o)
-            for (int i = 0; i < in_ch; ++i)
-                for (int x = 0; x < k; ++x)
-                    for (int y = 0; y < k; ++y)
-                        weights[o][i][x][y] = randn(stddev);
-    }
-
-    Tensor4D forward(const Tensor4D& x) {
-        input = x;
-        int batch = x.size();
-        int h = x[0][0].size();
-        int w = x[0][0][0].size();
-        int out_h = h - kernel_size + 1;
-        int out_w = w - kernel_size + 1;
-
-        Tensor4D output(batch,
-                        std::vector<std::vector<std::vector<double>>>( // Use double
-                            out_channels,
-                            std::vector<std::vector<double>>(out_h, std::vector<double>(out_w, 0.0)))); // Use double
+
+        for (double& w : weights)
+            w = randn(stddev);
+    }
+
+    void bind(Workspace& ws, const Tensor4D& x) {
+        int batch = x.dim(0);
+        int h = x.dim(2);
+        int w = x.dim(3);
+        output = ws.take(batch, out_channels, h - kernel_size + 1, w - kernel_size + 1);
+        int patch = in_channels * kernel_size * kernel_size;
+        int pixels = (h - kernel_size + 1) * (w - kernel_size + 1);
+        col = ws.take(patch, pixels);
+        if (needs_input_grad) {
+            d_input = ws.take(batch, in_channels, h, w);
+            d_col = ws.take(patch, pixels);
+        } else {
+            d_input = Tensor4D();
+            d_col = Matrix();
+        }
+        wino_v = ws.take(std::max(in_channels, out_channels) * 16);
+    }
+
+    // Refreshes the Winograd transforms right away (when that backend is
+    // selected), so a const infer() finds them current
+    void weights_changed() {
+        wino_stale = true;
+        if (backend == ConvBackend::Winograd && kernel_size == 3) update_winograd_filters();
+    }
+
+    const Tensor4D& forward(const Tensor4D& x) {
+        input = &x;
+        if (backend == ConvBackend::Winograd && kernel_size == 3) update_winograd_filters();
+        compute(x, output, col.data(), wino_v.data());
+        return output;
+    }
+
+    // Doubles of scratch infer() needs for an h × w input
+    std::size_t infer_scratch_size(int h, int w) const {
+        std::size_t patches = std::size_t(in_channels) * kernel_size * kernel_size * (h - kernel_size + 1) *
+                              (w - kernel_size + 1);
+        return std::max(patches, std::size_t(std::max(in_channels, out_channels)) * 16);
+    }
+
+    // out: (batch, out_ch, h − k + 1, w − k + 1). Winograd is used only
+    // while its filter transforms are current (im2col otherwise), since
+    // refreshing them would write to the layer.
+    void infer(const Tensor4D& x, Tensor4D& out, double* scratch) const {
+        compute(x, out, scratch, scratch);
+    }
+
+    void compute(const Tensor4D& x, Tensor4D& out, double* col_buf, double* wino_buf) const {
+        if (backend == ConvBackend::Simd3x3 && kernel_size == 3)
+            forward_simd3x3(x, out);
+        else if (backend == ConvBackend::Winograd && kernel_size == 3 && !wino_stale)
+            forward_winograd(x, out, wino_buf);
+        else if (backend == ConvBackend::Direct)
+            forward_direct(x, out);
+        else
+            forward_im2col(x, out, col_buf);
+    }
+
+    void forward_direct(const Tensor4D& x, Tensor4D& output) const {
+        int batch = x.dim(0);
+        int out_h = output.dim(2);
+        int out_w = output.dim(3);
 
         for (int b = 0; b < batch; ++b) {
             for (int o = 0; o < out_channels; ++o) {
@@ -62,63 +146,143 @@ public:
                         for (int c = 0; c < in_channels; ++c) {
                             for (int m = 0; m < kernel_size; ++m)
                                 for (int n = 0; n < kernel_size; ++n)
-                                    sum += x[b][c][i + m][j + n] * weights[o][c][m][n];
+                                    sum += x(b, c, i + m, j + n) * weights(o, c, m, n);
                         }
-                        output[b][o][i][j] = sum + biases[o];
+                        output(b, o, i, j) = sum + biases[o];
                     }
                 }
             }
         }
-        return output;
     }
 
-    Tensor4D backward(const Tensor4D& d_out, double lr) { // Use double
-        int batch = input.size();
-        int in_h = input[0][0].size();
-        int in_w = input[0][0][0].size();
-        int out_h = d_out[0][0].size();
-        int out_w = d_out[0][0][0].size();
+    // output[b] (out × out_h·out_w) = weights (out × in·k·k) · im2col(x[b])
+    void forward_im2col(const Tensor4D& x, Tensor4D& output, double* col_buf) const {
+        int batch = x.dim(0);
+        int patch = in_channels * kernel_size * kernel_size;
+        int pixels = output.dim(2) * output.dim(3);
 
-        Tensor4D d_input(batch,
-                         std::vector<std::vector<std::vector<double>>>( // Use double
-                             in_channels,
-                             std::vector<std::vector<double>>(in_h, std::vector<double>(in_w, 0.0)))); // Use double
+        for (int b = 0; b < batch; ++b) {
+            im2col(x.sample(b), in_channels, x.dim(2), x.dim(3), kernel_size, col_buf);
+            double* out = output.sample(b);
+            for (int o = 0; o < out_channels; ++o)
+                std::fill_n(out + std::size_t(o) * pixels, pixels, biases[o]);
+            gemm(false, false, out_channels, pixels, patch,
+                 weights.data(), patch, col_buf, pixels, out, pixels, true);
+        }
+    }
 
-        auto dw = weights; //copy
-        for (auto& f : dw)
-            for (auto& c : f)
-                for (auto& r : c)
-                    std::fill(r.begin(), r.end(), 0.0); // Use double
+    void forward_simd3x3(const Tensor4D& x, Tensor4D& output) const {
+        Conv3x3Kernel kernel = conv3x3_dispatch();
+        for (int b = 0; b < x.dim(0); ++b)
+            kernel(x.sample(b), in_channels, x.dim(2), x.dim(3),
+                   weights.data(), biases.data(), out_channels, output.sample(b));
+    }
 
-        std::vector<double> db(out_channels, 0.0); // Use double
+    // Needs current filter transforms (update_winograd_filters())
+    void forward_winograd(const Tensor4D& x, Tensor4D& output, double* v_buf) const {
+        for (int b = 0; b < x.dim(0); ++b)
+            winograd::conv3x3(x.sample(b), in_channels, x.dim(2), x.dim(3), 0,
+                              wino_u.data(), out_channels, biases.data(),
+                              output.sample(b), v_buf);
+    }
+
+    void update_winograd_filters() {
+        if (!wino_stale) return;
+        if (wino_u.size() != weights.size() / 9 * 16) {
+            wino_u = Tensor(out_channels, in_channels * 16);
+            wino_u_back = Tensor(in_channels, out_channels * 16);
+        }
+        for (int o = 0; o < out_channels; ++o)
+            for (int c = 0; c < in_channels; ++c) {
+                const double* g = weights.data() + (std::size_t(o) * in_channels + c) * 9;
+                winograd::transform_filter(g, wino_u.sample(o) + c * 16);
+                winograd::transform_filter(g, wino_u_back.sample(c) + o * 16, true);
+            }
+        wino_stale = false;
+    }
+
+    // Fills dw/db; returns dL/dx, or an empty tensor when needs_input_grad is false
+    const Tensor4D& backward(const Tensor4D& d_out) {
+        bool winograd = backend == ConvBackend::Winograd && kernel_size == 3;
+        if (backend == ConvBackend::Direct) {
+            backward_direct(d_out);
+        } else {
+            backward_im2col(d_out, needs_input_grad && !winograd);
+            if (needs_input_grad && winograd) backward_winograd_data(d_out);
+        }
+        return d_input;
+    }
+
+    void backward_direct(const Tensor4D& d_out) {
+        const Tensor4D& x = *input;
+        int batch = x.dim(0);
+        int out_h = d_out.dim(2);
+        int out_w = d_out.dim(3);
+
+        if (needs_input_grad) d_input.zero();
+        dw.zero();
+        db.zero();
 
         for (int b = 0; b < batch; ++b) {
             for (int o = 0; o < out_channels; ++o) {
                 for (int i = 0; i < out_h; ++i) {
                     for (int j = 0; j < out_w; ++j) {
-                        double grad = d_out[b][o][i][j]; // Use double
+                        double grad = d_out(b, o, i, j); // Use double
                         db[o] += grad;
                         for (int c = 0; c < in_channels; ++c) {
                             for (int m = 0; m < kernel_size; ++m)
                                 for (int n = 0; n < kernel_size; ++n) {
-                                    dw[o][c][m][n] += grad * input[b][c][i + m][j + n];
-                                    d_input[b][c][i + m][j + n] += grad * weights[o][c][m][n];
+                                    dw(o, c, m, n) += grad * x(b, c, i + m, j + n);
+                                    if (needs_input_grad)
+                                        d_input(b, c, i + m, j + n) += grad * weights(o, c, m, n);
                                 }
                         }
                     }
                 }
             }
         }
+    }
+
+    // Two GEMM-shaped passes per image, no scatter inside the inner loops:
+    //   dW (out × in·k·k)        += dOut[b] (out × pixels) · im2col(x[b])ᵀ
+    //   d_col (in·k·k × pixels)   = Wᵀ · dOut[b],  then dX[b] = col2im(d_col)
+    void backward_im2col(const Tensor4D& d_out, bool with_input_grad) {
+        const Tensor4D& x = *input;
+        int batch = x.dim(0);
+        int patch = in_channels * kernel_size * kernel_size;
+        int pixels = d_out.dim(2) * d_out.dim(3);
 
-        for (int o = 0; o < out_channels; ++o) {
-            for (int c = 0; c < in_channels; ++c)
-                for (int m = 0; m < kernel_size; ++m)
-                    for (int n = 0; n < kernel_size; ++n)
-                        weights[o][c][m][n] -= lr * dw[o][c][m][n];
-            biases[o] -= lr * db[o];
+        dw.zero();
+        db.zero();
+
+        for (int b = 0; b < batch; ++b) {
+            const double* g = d_out.sample(b);
+            for (int o = 0; o < out_channels; ++o) {
+                const double* row = g + std::size_t(o) * pixels;
+                double sum = 0.0;
+                for (int p = 0; p < pixels; ++p) sum += row[p];
+                db[o] += sum;
+            }
+
+            im2col(x.sample(b), in_channels, x.dim(2), x.dim(3), kernel_size, col.data());
+            gemm(false, true, out_channels, patch, pixels,
+                 g, pixels, col.data(), pixels, dw.data(), patch, true);
+
+            if (!with_input_grad) continue;
+            gemm(true, false, patch, pixels, out_channels,
+                 weights.data(), patch, g, pixels, d_col.data(), pixels);
+            col2im(d_col.data(), in_channels, x.dim(2), x.dim(3), kernel_size, d_input.sample(b));
         }
+    }
 
-        return d_input;
+    // dX[b] = full correlation of dOut[b] (zero-padded by 2) with the
+    // rotated filters, i.e. another F(2×2, 3×3) pass with in/out swapped
+    void backward_winograd_data(const Tensor4D& d_out) {
+        update_winograd_filters();
+        for (int b = 0; b < d_out.dim(0); ++b)
+            winograd::conv3x3(d_out.sample(b), out_channels, d_out.dim(2), d_out.dim(3), 2,
+                              wino_u_back.data(), in_channels, nullptr,
+                              d_input.sample(b), wino_v.data());
     }
 };
 
@@ -126,82 +290,84 @@ public:
 // ReLU
 class ReLU {
 public:
-    Tensor4D mask;
+    Tensor4D output, mask, grad;
+    long active_count = 0; // positive outputs in the last forward()
 
-    Tensor4D forward(const Tensor4D& x) {
-        mask = x;
-        Tensor4D out = x;
-
-        int active_count = 0;
-        int total_count = 0;
-
-        for (int b = 0; b < x.size(); ++b)
-            for (int c = 0; c < x[0].size(); ++c)
-                for (int i = 0; i < x[0][0].size(); ++i)
-                    for (int j = 0; j < x[0][0][0].size(); ++j) {
-                        double val = x[b][c][i][j]; // Use double
-                        if (val > 0.0) { // Changed from 0.0f to 0.0
-                            mask[b][c][i][j] = 1.0; // Use double
-                            ++active_count;
-                        } else {
-                            mask[b][c][i][j] = 0.0; // Use double
-                            out[b][c][i][j] = 0.0; // Use double
-                        }
-                        ++total_count;
-                    }
+    void bind(Workspace& ws, const Tensor4D& x) {
+        output = ws.take(x.dim(0), x.dim(1), x.dim(2), x.dim(3));
+        mask = ws.take(x.dim(0), x.dim(1), x.dim(2), x.dim(3));
+        grad = ws.take(x.dim(0), x.dim(1), x.dim(2), x.dim(3));
+    }
+
+    double density() const { return output.empty() ? 0.0 : double(active_count) / output.size(); }
+
+    const Tensor4D& forward(const Tensor4D& x) {
+        active_count = 0;
+
+        for (std::size_t k = 0; k < x.size(); ++k) {
+            if (x[k] > 0.0) { // Changed from 0.0f to 0.0
+                mask[k] = 1.0; // Use double
+                output[k] = x[k];
+                ++active_count;
+            } else {
+                mask[k] = 0.0; // Use double
+                output[k] = 0.0; // Use double
+            }
+        }
+
+        return output;
+    }
 
-        return out;
+    // out may be x itself
+    void infer(const Tensor4D& x, Tensor4D& out) const {
+        for (std::size_t k = 0; k < x.size(); ++k) out[k] = x[k] > 0.0 ? x[k] : 0.0;
     }
 
-    Tensor4D backward(const Tensor4D& d_out, double) { // Use double
-        Tensor4D out = d_out;
-        for (int b = 0; b < d_out.size(); ++b)
-            for (int c = 0; c < d_out[0].size(); ++c)
-                for (int i = 0; i < d_out[0][0].size(); ++i)
-                    for (int j = 0; j < d_out[0][0][0].size(); ++j)
-                        out[b][c][i][j] *= mask[b][c][i][j];
-        return out;
+    const Tensor4D& backward(const Tensor4D& d_out) {
+        for (std::size_t k = 0; k < grad.size(); ++k)
+            grad[k] = d_out[k] * mask[k];
+        return grad;
     }
 };
 
 class ReLU2D {
 public:
-    Matrix mask;
+    Matrix output, mask, grad;
+    long active_count = 0; // positive outputs in the last forward()
 
-    Matrix forward(const Matrix& x) {
-        int batch = x.size();
-        int features = x[0].size();
+    void bind(Workspace& ws, const Matrix& x) {
+        output = ws.take(x.dim(0), x.dim(1));
+        mask = ws.take(x.dim(0), x.dim(1));
+        grad = ws.take(x.dim(0), x.dim(1));
+    }
 
-        mask = Matrix(batch, std::vector<double>(features));
-        Matrix out = x;
+    double density() const { return output.empty() ? 0.0 : double(active_count) / output.size(); }
 
-        int active_count = 0;
-        int total_count = batch * features;
+    const Matrix& forward(const Matrix& x) {
+        active_count = 0;
 
-        for (int i = 0; i < batch; ++i) {
-            for (int j = 0; j < features; ++j) {
-                if (x[i][j] > 0.0) {
-                    mask[i][j] = 1.0;
-                    ++active_count;
-                } else {
-                    mask[i][j] = 0.0;
-                    out[i][j] = 0.0;
-                }
+        for (std::size_t k = 0; k < x.size(); ++k) {
+            if (x[k] > 0.0) {
+                mask[k] = 1.0;
+                output[k] = x[k];
+                ++active_count;
+            } else {
+                mask[k] = 0.0;
+                output[k] = 0.0;
             }
         }
 
-        return out;
+        return output;
     }
 
-    Matrix backward(const Matrix& d_out, double) {
-        int batch = d_out.size();
-        int features = d_out[0].size();
-
-        Matrix grad = d_out;
+    // out may be x itself
+    void infer(const Matrix& x, Matrix& out) const {
+        for (std::size_t k = 0; k < x.size(); ++k) out[k] = x[k] > 0.0 ? x[k] : 0.0;
+    }
 
-        for (int i = 0; i < batch; ++i)
-            for (int j = 0; j < features; ++j)
-                grad[i][j] *= mask[i][j];
+    const Matrix& backward(const Matrix& d_out) {
+        for (std::size_t k = 0; k < grad.size(); ++k)
+            grad[k] = d_out[k] * mask[k];
 
         return grad;
     }
@@ -211,30 +377,34 @@ public:
 // MaxPool2D
 class MaxPool2D {
 public:
-    Tensor4D input;
+    Tensor4D output;
     Tensor4D mask;
+    Tensor4D d_input;
     int pool_size = 2;
 
-    Tensor4D forward(const Tensor4D& x) {
-        input = x;
-        int batch = x.size();
-        int channels = x[0].size();
-        int h = x[0][0].size();
-        int w = x[0][0][0].size();
-        int out_h = h / pool_size;
-        int out_w = w / pool_size;
-
-        Tensor4D out(batch,
-                     std::vector<std::vector<std::vector<double>>>(
-                         channels,
-                         std::vector<std::vector<double>>(
-                             out_h, std::vector<double>(out_w))));
-
-        // Initialize the mask with zeros
-        mask = Tensor4D(batch,
-                        std::vector<std::vector<std::vector<double>>>(
-                            channels,
-                            std::vector<std::vector<double>>(h, std::vector<double>(w, 0.0))));
+    void bind(Workspace& ws, const Tensor4D& x) {
+        int batch = x.dim(0), channels = x.dim(1), h = x.dim(2), w = x.dim(3);
+        output = ws.take(batch, channels, h / pool_size, w / pool_size);
+        mask = ws.take(batch, channels, h, w);
+        d_input = ws.take(batch, channels, h, w);
+    }
+
+    const Tensor4D& forward(const Tensor4D& x) {
+        // Reset the mask to zeros
+        mask.zero();
+        pool(x, output, &mask);
+        return output;
+    }
+
+    // out: (batch, channels, h / pool_size, w / pool_size)
+    void infer(const Tensor4D& x, Tensor4D& out) const { pool(x, out, nullptr); }
+
+    // Window maxima into output; marks each argmax in *mask when given
+    void pool(const Tensor4D& x, Tensor4D& output, Tensor4D* mask) const {
+        int batch = x.dim(0);
+        int channels = x.dim(1);
+        int out_h = output.dim(2);
+        int out_w = output.dim(3);
 
         for (int b = 0; b < batch; ++b) {
             for (int c = 0; c < channels; ++c) {
@@ -247,7 +417,7 @@ public:
                             for (int n = 0; n < pool_size; ++n) {
                                 int row = i * pool_size + m;
                                 int col = j * pool_size + n;
-                                double val = x[b][c][row][col];
+                                double val = x(b, c, row, col);
                                 if (val > max_val) {
                                     max_val = val;
                                     max_i = row;
@@ -256,28 +426,21 @@ public:
                             }
                         }
 
-                        out[b][c][i][j] = max_val;
-                        mask[b][c][max_i][max_j] = 1.0;
+                        output(b, c, i, j) = max_val;
+                        if (mask) (*mask)(b, c, max_i, max_j) = 1.0;
                     }
                 }
             }
         }
-
-        return out;
     }
 
-    Tensor4D backward(const Tensor4D& d_out, double) {
-        int batch = d_out.size();
-        int channels = d_out[0].size();
-        int out_h = d_out[0][0].size();
-        int out_w = d_out[0][0][0].size();
-        int h = out_h * pool_size;
-        int w = out_w * pool_size;
+    const Tensor4D& backward(const Tensor4D& d_out) {
+        int batch = d_out.dim(0);
+        int channels = d_out.dim(1);
+        int out_h = d_out.dim(2);
+        int out_w = d_out.dim(3);
 
-        Tensor4D d_input(batch,
-                         std::vector<std::vector<std::vector<double>>>(
-                             channels,
-                             std::vector<std::vector<double>>(h, std::vector<double>(w, 0.0))));
+        d_input.zero();
 
         for (int b = 0; b < batch; ++b) {
             for (int c = 0; c < channels; ++c) {
@@ -287,8 +450,8 @@ public:
                             for (int n = 0; n < pool_size; ++n) {
                                 int row = i * pool_size + m;
                                 int col = j * pool_size + n;
-                                if (mask[b][c][row][col] == 1.0)
-                                    d_input[b][c][row][col] = d_out[b][c][i][j];
+                                if (mask(b, c, row, col) == 1.0)
+                                    d_input(b, c, row, col) = d_out(b, c, i, j);
                             }
                         }
                     }
@@ -302,41 +465,174 @@ public:
 
 
 // ───────────────────────────
-// Flatten
-class Flatten {
+// ConvReLUPool
+// Conv2D → ReLU → MaxPool2D(2) in one pass. Two conv output rows of every
+// channel at a time are computed into a small scratch strip, then
+// rectified and pooled straight into the pooled output, so the full-size
+// conv activation and both masks are never materialized. With the
+// Simd3x3 backend the strip comes from the dispatched conv3x3 kernel run
+// on the input rows behind it; other backends use a scalar row sweep. The only record kept for backward is
+// one argmax byte per pooled cell (−1 when the window max is ≤ 0, where
+// ReLU blocks the gradient).
+//
+// The layer holds no weights: it runs a Conv2D it is handed, and feeds
+// that Conv2D's backward with the routed gradient.
+class ConvReLUPool {
 public:
-    int batch, channels, height, width;
+    static constexpr int pool_size = 2;
+    Tensor4D output;      // (batch, out_ch, out_h / 2, out_w / 2)
+    Tensor4D d_conv;      // gradient w.r.t. the conv output
+    std::int8_t* argmax = nullptr;
+    Tensor strip;         // two conv output rows of every channel, then the input rows behind them
+
+    void bind(Workspace& ws, const Conv2D& conv, const Tensor4D& x) {
+        int batch = x.dim(0);
+        int conv_h = x.dim(2) - conv.kernel_size + 1;
+        int conv_w = x.dim(3) - conv.kernel_size + 1;
+        output = ws.take(batch, conv.out_channels, conv_h / pool_size, conv_w / pool_size);
+        d_conv = ws.take(batch, conv.out_channels, conv_h, conv_w);
+        argmax = reinterpret_cast<std::int8_t*>(ws.take_bytes(output.size()));
+        strip = ws.take(static_cast<int>(infer_scratch_size(conv, x.dim(3))));
+    }
+
+    const Tensor4D& forward(Conv2D& conv, const Tensor4D& x) {
+        conv.input = &x;
+        run(conv, x, output, strip.data(), argmax);
+        return output;
+    }
+
+    // Backends whose arithmetic the fused pass reproduces
+    static bool fuses(const Conv2D& conv) {
+        return conv.backend == ConvBackend::Simd3x3 || conv.backend == ConvBackend::Direct;
+    }
+
+    // Doubles of scratch infer() needs: the strip, plus a copy of the
+    // input rows behind it (for the SIMD kernel, which wants them contiguous)
+    static std::size_t infer_scratch_size(const Conv2D& conv, int w) {
+        std::size_t rows = std::size_t(conv.out_channels) * pool_size * (w - conv.kernel_size + 1);
+        return rows + std::size_t(conv.in_channels) * (pool_size + conv.kernel_size - 1) * w;
+    }
+
+    // out: (batch, out_ch, conv_h / 2, conv_w / 2); no argmax is recorded
+    void infer(const Conv2D& conv, const Tensor4D& x, Tensor4D& out, double* scratch) const {
+        run(conv, x, out, scratch, nullptr);
+    }
+
+    // Fused pass into `output`; argmax records are written when non-null
+    static void run(const Conv2D& conv, const Tensor4D& x, Tensor4D& output, double* strip_buf,
+                    std::int8_t* argmax) {
+        int batch = x.dim(0);
+        int in_ch = conv.in_channels, k = conv.kernel_size;
+        int h = x.dim(2), w = x.dim(3);
+        int conv_w = w - k + 1;
+        int out_h = output.dim(2), out_w = output.dim(3);
+
+        int out_ch = conv.out_channels;
+        int window_h = pool_size + k - 1;  // input rows behind one strip
+        double* window = strip_buf + std::size_t(out_ch) * pool_size * conv_w;
+        Conv3x3Kernel kernel = conv.backend == ConvBackend::Simd3x3 && k == 3 ? conv3x3_dispatch() : nullptr;
 
-    std::vector<std::vector<double>> forward(const Tensor4D& x) { // Use double
-        batch = x.size();
-        channels = x[0].size();
-        height = x[0][0].size();
-        width = x[0][0][0].size();
-        std::vector<std::vector<double>> out(batch, std::vector<double>(channels * height * width)); // Use double
         for (int b = 0; b < batch; ++b) {
-            int idx = 0;
-            for (int c = 0; c < channels; ++c)
-                for (int i = 0; i < height; ++i)
-                    for (int j = 0; j < width; ++j)
-                        out[b][idx++] = x[b][c][i][j];
+            for (int pi = 0; pi < out_h; ++pi) {
+                // Conv rows 2·pi and 2·pi + 1 of every channel: strip (out_ch, 2, conv_w)
+                if (kernel) {
+                    const double* rows = x.sample(b) + std::size_t(pi) * pool_size * w;
+                    if (in_ch > 1) { // gather each channel's rows into one (in_ch, window_h, w) block
+                        for (int c = 0; c < in_ch; ++c)
+                            std::copy_n(rows + std::size_t(c) * h * w, std::size_t(window_h) * w,
+                                        window + std::size_t(c) * window_h * w);
+                        rows = window;
+                    }
+                    kernel(rows, in_ch, window_h, w, conv.weights.data(), conv.biases.data(), out_ch, strip_buf);
+                } else {
+                    for (int o = 0; o < out_ch; ++o)
+                        for (int r = 0; r < pool_size; ++r) {
+                            double* acc = strip_buf + (std::size_t(o) * pool_size + r) * conv_w;
+                            std::fill_n(acc, conv_w, conv.biases[o]);
+                            for (int c = 0; c < in_ch; ++c)
+                                for (int m = 0; m < k; ++m) {
+                                    const double* src = x.sample(b) + (std::size_t(c) * h + pi * pool_size + r + m) * w;
+                                    for (int n = 0; n < k; ++n) {
+                                        double wv = conv.weights(o, c, m, n);
+                                        for (int j = 0; j < conv_w; ++j) acc[j] += wv * src[j + n];
+                                    }
+                                }
+                        }
+                }
+
+                for (int o = 0; o < out_ch; ++o) {
+                    const double* rows = strip_buf + std::size_t(o) * pool_size * conv_w;
+                    double* dst = &output(b, o, pi, 0);
+                    std::int8_t* arg = argmax ? argmax + (dst - output.data()) : nullptr;
+                    for (int pj = 0; pj < out_w; ++pj) {
+                        double best = -1e9;
+                        int best_k = 0;
+                        for (int m = 0; m < pool_size; ++m)
+                            for (int n = 0; n < pool_size; ++n) {
+                                double v = rows[std::size_t(m) * conv_w + pj * pool_size + n];
+                                if (v > best) {
+                                    best = v;
+                                    best_k = m * pool_size + n;
+                                }
+                            }
+                        dst[pj] = best > 0.0 ? best : 0.0;
+                        if (arg) arg[pj] = static_cast<std::int8_t>(best > 0.0 ? best_k : -1);
+                    }
+                }
+            }
         }
-        return out;
     }
 
-    Tensor4D backward(const std::vector<std::vector<double>>& d_out) { // Use double
-        Tensor4D out(batch,
-                     std::vector<std::vector<std::vector<double>>>( // Use double
-                         channels,
-                         std::vector<std::vector<double>>(
-                             height, std::vector<double>(width)))); // Use double
-        for (int b = 0; b < batch; ++b) {
-            int idx = 0;
-            for (int c = 0; c < channels; ++c)
-                for (int i = 0; i < height; ++i)
-                    for (int j = 0; j < width; ++j)
-                        out[b][c][i][j] = d_out[b][idx++];
+    // Routes d_out back through the pool and ReLU, then runs conv.backward
+    const Tensor4D& backward(Conv2D& conv, const Tensor4D& d_out) {
+        int conv_w = d_conv.dim(3);
+        d_conv.zero();
+        for (std::size_t k = 0; k < d_out.size(); ++k) {
+            if (argmax[k] < 0) continue;
+            // k → (b·c, pi, pj) in the pooled grid
+            std::size_t plane = k / (std::size_t(output.dim(2)) * output.dim(3));
+            int rest = static_cast<int>(k % (std::size_t(output.dim(2)) * output.dim(3)));
+            int pi = rest / output.dim(3), pj = rest % output.dim(3);
+            int row = pi * pool_size + argmax[k] / pool_size;
+            int col = pj * pool_size + argmax[k] % pool_size;
+            d_conv[plane * d_conv.stride(1) + std::size_t(row) * conv_w + col] = d_out[k];
         }
-        return out;
+        return conv.backward(d_conv);
+    }
+};
+
+
+// ───────────────────────────
+// Flatten
+// Tensors are contiguous, so flattening is a reshaped view of the same
+// buffer. Flatten never writes through its views.
+class Flatten {
+public:
+    int batch, channels, height, width;
+    Matrix output;
+    Tensor4D d_input;
+
+    void bind(Workspace&, const Tensor4D& x) {
+        batch = x.dim(0);
+        channels = x.dim(1);
+        height = x.dim(2);
+        width = x.dim(3);
+        output = Tensor::view(nullptr, batch, channels * height * width); // shape only until forward()
+    }
+
+    const Matrix& forward(const Tensor4D& x) {
+        output = Tensor::view(const_cast<double*>(x.data()), batch, channels * height * width);
+        return output;
+    }
+
+    // A (batch, c·h·w) view of x; never written through
+    static Matrix infer(const Tensor4D& x) {
+        return Tensor::view(const_cast<double*>(x.data()), x.dim(0), x.dim(1) * x.dim(2) * x.dim(3));
+    }
+
+    const Tensor4D& backward(const Matrix& d_out) {
+        d_input = Tensor::view(const_cast<double*>(d_out.data()), batch, channels, height, width);
+        return d_input;
     }
 };
 
@@ -344,60 +640,213 @@ public:
 // Dense
 class Dense {
 public:
-    Matrix weights;
-    std::vector<double> biases;
-    Matrix input;
-
-    Dense(int in_features, int out_features) {
-        weights.resize(in_features, std::vector<double>(out_features)); // Use double
-        biases.resize(out_features, 0.0); // Use double
+    Matrix weights;             // (in_features, out_features)
+    Tensor biases;              // (out_features)
+
+    const Matrix* input = nullptr; // previous layer's output, must outlive backward()
+    Matrix output, d_input;
+    Matrix d_weights;           // dL/dweights from the last backward()
+    Tensor d_biases;            // dL/dbiases
+
+    // `weights` pre-packed into GEMM panels for forward() and infer().
+    // Call weights_changed() after writing `weights`.
+    Tensor packed;
+    bool packed_stale = true;
+
+    // Sparse path: when the fraction of non-zero inputs in a batch is below
+    // `sparse_below`, forward() lists the non-zero columns of each input row
+    // and both passes touch only the matching weight rows. 0 disables it,
+    // >1 forces it; bench.cpp measures the crossover. Set
+    // `zero_inputs_discard_grad` when the producer drops the gradient at
+    // zero inputs (ReLU, max-pool over ReLU): d_input is then only computed
+    // at non-zero inputs and left 0 elsewhere.
+    double sparse_below = 0.25;
+    bool zero_inputs_discard_grad = false;
+    long active_inputs = 0;     // non-zero inputs in the last forward()
+    bool used_sparse = false;   // path taken by the last forward()
+    int* active_index = nullptr; // (batch, in): non-zero columns of each row, packed at the front
+    int* active_per_row = nullptr;
+
+    Dense(int in_features, int out_features)
+        : weights(in_features, out_features), biases(out_features),
+          d_weights(in_features, out_features), d_biases(out_features) {
         double stddev = std::sqrt(2.0 / in_features); // Use double
-        for (auto& row : weights)
-            for (auto& val : row)
-                val = randn(stddev);
+        for (double& val : weights)
+            val = randn(stddev);
+    }
+
+    void bind(Workspace& ws, const Matrix& x) {
+        int batch = x.dim(0);
+        int in_dim = weights.dim(0);
+        int out_dim = weights.dim(1);
+        output = ws.take(batch, out_dim);
+        d_input = ws.take(batch, in_dim);
+        active_index = reinterpret_cast<int*>(ws.take_bytes(sizeof(int) * batch * in_dim));
+        active_per_row = reinterpret_cast<int*>(ws.take_bytes(sizeof(int) * batch));
+    }
+
+    // Only marks the panels stale: the next GEMM-path forward() repacks,
+    // so steps that take the sparse path never pay for it. infer() uses
+    // plain gemm() until then; call pack_weights() to serve it packed.
+    void weights_changed() { packed_stale = true; }
+
+    // Repacks `weights` into GEMM panels if they changed since the last pack
+    void pack_weights() {
+        if (!packed_stale) return;
+        int in_dim = weights.dim(0);
+        int out_dim = weights.dim(1);
+        std::size_t n = packed_b_size(in_dim, out_dim);
+        if (packed.size() != n) packed = Tensor(static_cast<int>(n));
+        pack_gemm_b(false, in_dim, out_dim, weights.data(), out_dim, packed.data());
+        packed_stale = false;
+    }
+
+    // Fraction of non-zero inputs seen by the last forward()
+    double input_density() const {
+        return input ? double(active_inputs) / input->size() : 0.0;
     }
 
-    Matrix forward(const Matrix& x) {
-        input = x;
-        int batch = x.size();
-        int out_dim = biases.size();
-        Matrix out(batch, std::vector<double>(out_dim, 0.0)); // Use double
+    // output (batch × out) = x (batch × in) · W (in × out) + biases
+    const Matrix& forward(const Matrix& x) {
+        input = &x;
+        int batch = x.dim(0);
+        int in_dim = weights.dim(0);
+        int out_dim = weights.dim(1);
         for (int b = 0; b < batch; ++b)
-            for (int j = 0; j < out_dim; ++j) {
-                out[b][j] = biases[j];
-                for (int i = 0; i < x[0].size(); ++i)
-                    out[b][j] += x[b][i] * weights[i][j];
+            std::copy(biases.begin(), biases.end(), output.data() + std::size_t(b) * out_dim);
+
+        active_inputs = index_active_inputs(x);
+        used_sparse = active_inputs < sparse_below * x.size();
+        if (used_sparse) {
+            // out[b] += x[b][i] · W[i] over the non-zero i only
+            for (int b = 0; b < batch; ++b) {
+                const double* xb = x.sample(b);
+                const int* idx = active_index + std::size_t(b) * in_dim;
+                double* o = output.sample(b);
+                for (int a = 0; a < active_per_row[b]; ++a) {
+                    double xv = xb[idx[a]];
+                    const double* row = weights.sample(idx[a]);
+                    for (int j = 0; j < out_dim; ++j) o[j] += xv * row[j];
+                }
             }
-        return out;
-    }
+            return output;
+        }
 
-    Matrix backward(const Matrix& d_out, double lr) { // Use double
-        int batch = d_out.size();
-        int in_dim = weights.size();
-        int out_dim = weights[0].size();
+        pack_weights();
+        gemm_packed(false, batch, out_dim, in_dim, x.data(), in_dim, packed.data(),
+                    output.data(), out_dim, true);
+        return output;
+    }
 
-        Matrix d_input(batch, std::vector<double>(in_dim, 0.0)); // Use double
-        Matrix d_weights(in_dim, std::vector<double>(out_dim, 0.0)); // Use double
-        std::vector<double> d_biases(out_dim, 0.0); // Use double
+    // out (batch × out) = x · W + biases, without indexing or recording
+    // anything. Uses the packed weights while they are current and plain
+    // gemm() otherwise, since repacking would write to the layer.
+    void infer(const Matrix& x, Matrix& out) const {
+        int batch = x.dim(0);
+        int in_dim = weights.dim(0);
+        int out_dim = weights.dim(1);
+        for (int b = 0; b < batch; ++b)
+            std::copy(biases.begin(), biases.end(), out.data() + std::size_t(b) * out_dim);
 
-        for (int b = 0; b < batch; ++b) {
-            for (int j = 0; j < out_dim; ++j) {
-                d_biases[j] += d_out[b][j];
+        long nonzero = x.size() - std::count(x.begin(), x.end(), 0.0);
+        if (nonzero < sparse_below * x.size()) {
+            for (int b = 0; b < batch; ++b) {
+                const double* xb = x.sample(b);
+                double* o = out.sample(b);
                 for (int i = 0; i < in_dim; ++i) {
-                    d_weights[i][j] += input[b][i] * d_out[b][j];
-                    d_input[b][i] += d_out[b][j] * weights[i][j];
+                    if (xb[i] == 0.0) continue;
+                    const double* row = weights.sample(i);
+                    for (int j = 0; j < out_dim; ++j) o[j] += xb[i] * row[j];
                 }
             }
+        } else if (!packed_stale) {
+            gemm_packed(false, batch, out_dim, in_dim, x.data(), in_dim, packed.data(), out.data(), out_dim, true);
+        } else {
+            gemm(false, false, batch, out_dim, in_dim, x.data(), in_dim, weights.data(), out_dim,
+                 out.data(), out_dim, true);
         }
-        // ✅ Actually update model weights and biases
-        for (int i = 0; i < in_dim; ++i)
-            for (int j = 0; j < out_dim; ++j)
-                weights[i][j] -= lr * d_weights[i][j];  // modify actual member
+    }
 
-        for (int j = 0; j < out_dim; ++j)
-            biases[j] -= lr * d_biases[j];
+    // dW = Xᵀ · dY, db = Σ_b dY[b] and dX = dY · Wᵀ
+    const Matrix& backward(const Matrix& d_out) {
+        const Matrix& x = *input;
+        int batch = d_out.dim(0);
+        int in_dim = weights.dim(0);
+        int out_dim = weights.dim(1);
+
+        if (used_sparse)
+            backward_sparse(d_out);
+        else {
+            gemm(true, false, in_dim, out_dim, batch, x.data(), in_dim, d_out.data(), out_dim,
+                 d_weights.data(), out_dim);
+            gemm(false, true, batch, in_dim, out_dim, d_out.data(), out_dim, weights.data(), out_dim,
+                 d_input.data(), in_dim);
+        }
+
+        d_biases.zero();
+        for (int b = 0; b < batch; ++b)
+            for (int j = 0; j < out_dim; ++j)
+                d_biases[j] += d_out(b, j);
         return d_input;
     }
+
+private:
+    // Fills active_index/active_per_row and returns the total count
+    long index_active_inputs(const Matrix& x) {
+        int in_dim = x.dim(1);
+        long total = 0;
+        for (int b = 0; b < x.dim(0); ++b) {
+            const double* xb = x.sample(b);
+            int* idx = active_index + std::size_t(b) * in_dim;
+            int n = 0;
+            for (int i = 0; i < in_dim; ++i) {
+                idx[n] = i;
+                n += xb[i] != 0.0;
+            }
+            active_per_row[b] = n;
+            total += n;
+        }
+        return total;
+    }
+
+    void backward_sparse(const Matrix& d_out) {
+        const Matrix& x = *input;
+        int batch = d_out.dim(0);
+        int in_dim = weights.dim(0);
+        int out_dim = weights.dim(1);
+
+        // dW[i] += x[b][i] · dY[b], rows of zero inputs stay 0
+        d_weights.zero();
+        for (int b = 0; b < batch; ++b) {
+            const double* xb = x.sample(b);
+            const double* g = d_out.sample(b);
+            const int* idx = active_index + std::size_t(b) * in_dim;
+            for (int a = 0; a < active_per_row[b]; ++a) {
+                double xv = xb[idx[a]];
+                double* row = d_weights.sample(idx[a]);
+                for (int j = 0; j < out_dim; ++j) row[j] += xv * g[j];
+            }
+        }
+
+        if (!zero_inputs_discard_grad) {
+            gemm(false, true, batch, in_dim, out_dim, d_out.data(), out_dim, weights.data(), out_dim,
+                 d_input.data(), in_dim);
+            return;
+        }
+        // dX[b][i] = dY[b] · W[i] at the non-zero inputs only
+        d_input.zero();
+        for (int b = 0; b < batch; ++b) {
+            const double* g = d_out.sample(b);
+            const int* idx = active_index + std::size_t(b) * in_dim;
+            double* dx = d_input.sample(b);
+            for (int a = 0; a < active_per_row[b]; ++a) {
+                const double* row = weights.sample(idx[a]);
+                double acc = 0.0;
+                for (int j = 0; j < out_dim; ++j) acc += g[j] * row[j];
+                dx[idx[a]] = acc;
+            }
+        }
+    }
 };
 
 #endif
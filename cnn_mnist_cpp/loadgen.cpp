@@ -0,0 +1,48 @@
+#include "inference_server.h"
+#include "binary_dataset.h"
+#include "data_loader.h"
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+
+// Load generator for ./serve: a number of clients, each sending test
+// images one at a time over its own connection, all at once. Reports
+// latency percentiles, throughput and accuracy against the labels.
+// ./loadgen [--socket=PATH]    default /tmp/cnn_mnist.sock
+//           [--clients=N]      concurrent connections, default 32
+//           [--requests=N]     images per client, default 200
+int main(int argc, char** argv) {
+    std::string socket_path = "/tmp/cnn_mnist.sock";
+    int clients = 32, requests = 200;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--socket=", 0) == 0) socket_path = arg.substr(9);
+        else if (arg.rfind("--clients=", 0) == 0) clients = std::max(1, std::stoi(arg.substr(10)));
+        else if (arg.rfind("--requests=", 0) == 0) requests = std::max(1, std::stoi(arg.substr(11)));
+    }
+
+    std::cout << "📦 Loading test images...\n";
+    Dataset images;
+    if (std::filesystem::exists("../MNIST/test.bin")) {
+        MappedDataset file("../MNIST/test.bin");
+        std::vector<int> all(file.size());
+        std::iota(all.begin(), all.end(), 0);
+        images = file.to_packed_dataset(all);
+    } else {
+        images = load_csv_dataset("../MNIST/test_images.csv", "../MNIST/test_labels.csv", true);
+    }
+
+    std::cout << "🚦 " << clients << " clients × " << requests << " requests against " << socket_path << "...\n";
+    try {
+        LoadReport r = generate_load(socket_path, images, clients, requests);
+        std::cout << "⏱️  Latency p50 " << std::fixed << std::setprecision(2) << r.p50 * 1e3 << " ms, p99 "
+                  << r.p99 * 1e3 << " ms, max " << r.max * 1e3 << " ms\n"
+                  << "🚀 Throughput " << std::setprecision(0) << r.throughput() << " img/s (" << r.requests
+                  << " requests in " << std::setprecision(2) << r.seconds << " s)\n"
+                  << "✅ Accuracy: " << std::setprecision(4) << 100.0 * r.correct / r.requests << "%\n";
+    } catch (const std::exception& e) {
+        std::cout << "❌ " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
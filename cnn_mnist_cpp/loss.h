@@ -1,6 +1,8 @@
 #ifndef LOSS_H
 #define LOSS_H
 
+#include "tensor.h"
+#include "workspace.h"
 #include <vector>
 #include <cmath>
 #include <cassert>
@@ -8,46 +10,50 @@
 
 class SoftmaxCrossEntropy {
 public:
-    std::vector<std::vector<double>> probs; // Use double
+    Tensor probs; // (batch, classes)
+    Tensor grad;
     std::vector<int> y;
 
-    double forward(const std::vector<std::vector<double>>& logits, const std::vector<int>& labels) { // Use double
+    void bind(Workspace& ws, const Tensor& logits) {
+        probs = ws.take(logits.dim(0), logits.dim(1));
+        grad = ws.take(logits.dim(0), logits.dim(1));
+    }
+
+    double forward(const Tensor& logits, const std::vector<int>& labels) { // Use double
         y = labels;
-        int batch_size = logits.size();
-        int num_classes = logits[0].size();
-        probs.resize(batch_size, std::vector<double>(num_classes)); // Use double
+        int batch_size = logits.dim(0);
+        int num_classes = logits.dim(1);
 
         double loss = 0.0; // Use double
 
         for (int i = 0; i < batch_size; ++i) {
-            double max_logit = *std::max_element(logits[i].begin(), logits[i].end()); // Use double
+            const double* row = logits.sample(i);
+            double max_logit = *std::max_element(row, row + num_classes); // Use double
 
             double sum_exp = 0.0; // Use double
             for (int j = 0; j < num_classes; ++j) {
-                probs[i][j] = std::exp(logits[i][j] - max_logit);
-                sum_exp += probs[i][j];
+                probs(i, j) = std::exp(row[j] - max_logit);
+                sum_exp += probs(i, j);
             }
 
             for (int j = 0; j < num_classes; ++j)
-                probs[i][j] /= sum_exp;
+                probs(i, j) /= sum_exp;
 
-            loss += -std::log(probs[i][labels[i]] + 1e-9); // Use double
+            loss += -std::log(probs(i, labels[i]) + 1e-9); // Use double
         }
 
         return loss / batch_size;
     }
 
-    std::vector<std::vector<double>> backward() { // Use double
-        int batch_size = probs.size();
-        int num_classes = probs[0].size();
-        std::vector<std::vector<double>> grad = probs; // Use double
+    const Tensor& backward() { // Use double
+        int batch_size = probs.dim(0);
+        grad = probs; // copies into the bound buffer
 
         for (int i = 0; i < batch_size; ++i)
-            grad[i][y[i]] -= 1.0; // Changed from 1.0f to 1.0
+            grad(i, y[i]) -= 1.0; // Changed from 1.0f to 1.0
 
-        for (int i = 0; i < batch_size; ++i)
-            for (int j = 0; j < num_classes; ++j)
-                grad[i][j] /= batch_size;
+        for (double& g : grad)
+            g /= batch_size;
 
         return grad;
     }
@@ -1,11 +1,21 @@
 #include "data_loader.h"
+#include "prefetch.h"
+#include "binary_dataset.h"
+#include "streaming.h"
 #include "model.h"
+#include "data_parallel.h"
+#include "hogwild.h"
 #include "utils.h"
+#include "async_checkpoint.h"
 #include <iostream>
 #include <random>
 #include <algorithm>
 #include <iomanip>
 #include <cmath>
+#include <numeric>
+#include <thread>
+#include <memory>
+#include <string>
 
 void print_progress_bar(size_t current, size_t total, int width = 50) {
     float progress = static_cast<float>(current) / total;
@@ -17,89 +27,169 @@ void print_progress_bar(size_t current, size_t total, int width = 50) {
     std::cout.flush();
 }
 
-int main() {
-    std::cout << "📦 Loading MNIST data...\n";
-
-    std::vector<Image> all_images = load_csv_images("../MNIST/train_images.csv");
-    std::vector<int> all_labels = load_csv_labels("../MNIST/train_labels.csv");
-
-    std::vector<Image> x_train_flat, x_test_flat;
-    std::vector<int> y_train, y_test;
-
-    select_balanced_subset(all_images, all_labels, x_train_flat, y_train, 500);
-    select_balanced_subset(all_images, all_labels, x_test_flat, y_test, 10);
+void report_checkpoint(double stall_seconds) {
+    std::cout << "💾 Checkpoint snapshot taken, training stalled " << std::fixed << std::setprecision(2)
+              << stall_seconds * 1e3 << " ms\n";
+}
 
-    auto to_tensor = [](const std::vector<Image>& data) {
-        Tensor4D out(data.size(), std::vector<std::vector<std::vector<double>>>(
-                                      1, std::vector<std::vector<double>>(
-                                             28, std::vector<double>(28, 0.0))));
-        for (size_t i = 0; i < data.size(); ++i)
-            for (int r = 0; r < 28; ++r)
-                for (int c = 0; c < 28; ++c)
-                    out[i][0][r][c] = data[i][r * 28 + c];
-        return out;
-    };
+// ./main             synchronous data-parallel SGD
+// ./main --hogwild   asynchronous Hogwild SGD on the same threads
+// ./main --momentum  SGD with momentum 0.9 (synchronous only)
+// ./main --adam      Adam, lr 1e-3 (synchronous only)
+// ./main --stream[=MB]  train on all of ../MNIST/train.bin, streamed through
+//                       a shuffle buffer in at most MB of memory (default 64)
+int main(int argc, char** argv) {
+    bool hogwild = false;
+    std::string optimizer_name = "sgd";
+    std::size_t stream_mb = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--hogwild") hogwild = true;
+        else if (arg == "--momentum") optimizer_name = "momentum";
+        else if (arg == "--adam") optimizer_name = "adam";
+        else if (arg.rfind("--stream", 0) == 0) stream_mb = arg.size() > 9 ? std::stoul(arg.substr(9)) : 64;
+    }
+    if (stream_mb && hogwild) {
+        std::cout << "⚠️  --hogwild needs the data in memory; streaming with synchronous SGD instead\n";
+        hogwild = false;
+    }
+    if (stream_mb && !std::filesystem::exists("../MNIST/train.bin")) {
+        std::cout << "❌ --stream reads ../MNIST/train.bin; run ./convert first\n";
+        return 1;
+    }
 
-    Tensor4D x_train = to_tensor(x_train_flat);
-    Tensor4D x_test = to_tensor(x_test_flat);
+    Dataset train, test;
+    if (stream_mb) {
+        std::cout << "🌊 Streaming MNIST data from ../MNIST/train.bin within " << stream_mb << " MB...\n";
+    } else if (std::filesystem::exists("../MNIST/train.bin")) {
+        // One pass over the file, keeping only the balanced subset
+        std::cout << "📦 Reading MNIST data from ../MNIST/train.bin...\n";
+        DatasetStream file("../MNIST/train.bin", 4096);
+        train = sample_balanced(file, 500);
+        test = train.subset(balanced_indices(train.size(), [&](int i) { return train.labels[i]; }, 10));
+    } else {
+        std::cout << "📦 Loading MNIST data (run ./convert once to skip CSV parsing)...\n";
+
+        double error = 0.0;
+        Dataset all = load_csv_dataset("../MNIST/train_images.csv", "../MNIST/train_labels.csv", true, &error);
+        if (error > 1e-6)
+            std::cout << "⚠️  Pixels are not multiples of 1/255; stored to the nearest, max error "
+                      << std::scientific << std::setprecision(1) << error << std::defaultfloat << "\n";
+        auto label = [&](int i) { return all.labels[i]; };
+        train = all.subset(balanced_indices(all.size(), label, 500));
+        test = all.subset(balanced_indices(all.size(), label, 10));
+    }
+    // Samples stay uint8; batches are dequantized as they are gathered
+    if (!stream_mb)
+        std::cout << "🗜️  Training set: " << train.size() << " samples, " << std::fixed << std::setprecision(1)
+                  << train.bytes() / 1e6 << " MB packed, peak RSS " << peak_rss_mb() << " MB\n";
 
     CNN model;
     double lr = 0.01;
+    Optimizer optimizer = optimizer_name == "adam"     ? Optimizer::adam(1e-3)
+                        : optimizer_name == "momentum" ? Optimizer::with_momentum(lr)
+                                                       : Optimizer::sgd(lr);
     int epochs = 10;
     int batch_size = 64;
+    std::unique_ptr<PrefetchLoader> loader; // next batch is gathered while this one trains
+    std::unique_ptr<StreamingLoader> streaming;
+    std::vector<int> hogwild_order;         // Hogwild workers gather their own batches
+    std::mt19937 gen(std::random_device{}());
+    if (hogwild) {
+        hogwild_order.resize(train.size());
+        std::iota(hogwild_order.begin(), hogwild_order.end(), 0);
+    } else if (stream_mb) {
+        streaming = std::make_unique<StreamingLoader>("../MNIST/train.bin", batch_size, stream_mb << 20);
+        std::cout << "🌊 Shuffle buffer: " << streaming->shuffle_capacity() << " samples, loader memory "
+                  << std::fixed << std::setprecision(1) << streaming->memory_bytes() / 1e6 << " MB\n";
+    } else {
+        loader = std::make_unique<PrefetchLoader>(train, batch_size);
+    }
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::unique_ptr<DataParallelTrainer> trainer;
+    std::unique_ptr<HogwildTrainer> hogwild_trainer;
+    if (hogwild)
+        hogwild_trainer = std::make_unique<HogwildTrainer>(model, threads);
+    else
+        trainer = std::make_unique<DataParallelTrainer>(model, threads);
 
     std::vector<double> train_loss;
     std::vector<double> train_acc;
 
-    std::cout << "🚀 Starting training...\n";
+    // Every epoch ends with a checkpoint, written in the background
+    AsyncCheckpointer checkpointer(model_tensors(model), "trained_model.ckpt");
+
+    std::cout << "🚀 Starting " << (hogwild ? "Hogwild" : optimizer_name) << " training on " << threads << " thread(s)...\n";
 
     for (int epoch = 0; epoch < epochs; ++epoch) {
         std::cout << "\n📘 Epoch " << (epoch + 1) << "/" << epochs << "\n";
 
-        std::vector<int> indices(x_train.size());
-        std::iota(indices.begin(), indices.end(), 0);
-        std::shuffle(indices.begin(), indices.end(), std::mt19937(std::random_device{}()));
-
-        Tensor4D x_train_shuffled;
-        std::vector<int> y_train_shuffled;
-        for (int idx : indices) {
-            x_train_shuffled.push_back(x_train[idx]);
-            y_train_shuffled.push_back(y_train[idx]);
+        if (hogwild_trainer) {
+            std::shuffle(hogwild_order.begin(), hogwild_order.end(), gen);
+            train_loss.push_back(hogwild_trainer->epoch(train, hogwild_order, batch_size, lr));
+            int correct = 0;
+            Batch batch;
+            for (DataLoader in_order(train, 256, false); in_order.next(batch);) {
+                auto preds = model.predict(batch.x);
+                for (size_t j = 0; j < preds.size(); ++j)
+                    if (preds[j] == batch.y[j]) ++correct;
+            }
+            train_acc.push_back(static_cast<double>(correct) / train.size());
+            std::cout << "✅ Epoch " << (epoch + 1) << " finished - Loss: "
+                      << std::fixed << std::setprecision(4) << train_loss.back()
+                      << ", Accuracy: " << std::fixed << std::setprecision(2)
+                      << train_acc.back() * 100.0 << "%\n";
+            report_checkpoint(checkpointer.snapshot());
+            continue;
         }
 
-        size_t steps = (x_train.size() + batch_size - 1) / batch_size;
-        double epoch_loss = 0.0;
-        int correct = 0, total = 0;
-
-        for (size_t step = 0; step < steps; ++step) {
-            size_t i = step * batch_size;
-            size_t end = std::min(i + batch_size, x_train.size());
-            Tensor4D x_batch(x_train_shuffled.begin() + i, x_train_shuffled.begin() + end);
-            std::vector<int> y_batch(y_train_shuffled.begin() + i, y_train_shuffled.begin() + end);
-
-            double loss = model.forward(x_batch, y_batch);
-            model.backward(lr);
-            epoch_loss += loss;
-
-            auto preds = model.predict(x_batch);
-            for (size_t j = 0; j < preds.size(); ++j)
-                if (preds[j] == y_batch[j]) ++correct;
-            total += preds.size();
-
-            print_progress_bar(step + 1, steps);
-        }
-
-        double acc = static_cast<double>(correct) / total;
-        train_loss.push_back(epoch_loss / steps);
-        train_acc.push_back(acc);
-
-        std::cout << "\n✅ Epoch " << (epoch + 1) << " finished - Loss: "
-                  << std::fixed << std::setprecision(4) << train_loss.back()
-                  << ", Accuracy: " << std::fixed << std::setprecision(2)
-                  << train_acc.back() * 100.0 << "%\n";
+        // Same loop over the in-memory prefetcher or the file stream
+        auto run_epoch = [&](auto& loader) {
+            loader.start_epoch();
+            size_t steps = loader.steps();
+            double epoch_loss = 0.0;
+            int correct = 0, total = 0;
+            double fc1_density = 0.0, fc2_density = 0.0;
+
+            Batch batch;
+            for (size_t step = 0; loader.next(batch); ++step) {
+                double loss = trainer->step(batch.x, batch.y, optimizer);
+                fc1_density += model.fc1.input_density(); // thread 0's shard
+                fc2_density += model.fc2.input_density();
+                epoch_loss += loss;
+
+                auto preds = model.predict(batch.x);
+                for (size_t j = 0; j < preds.size(); ++j)
+                    if (preds[j] == batch.y[j]) ++correct;
+                total += preds.size();
+
+                print_progress_bar(step + 1, steps);
+            }
+
+            double acc = static_cast<double>(correct) / total;
+            train_loss.push_back(epoch_loss / steps);
+            train_acc.push_back(acc);
+
+            std::cout << "\n✅ Epoch " << (epoch + 1) << " finished - Loss: "
+                      << std::fixed << std::setprecision(4) << train_loss.back()
+                      << ", Accuracy: " << std::fixed << std::setprecision(2)
+                      << train_acc.back() * 100.0 << "%\n";
+            std::cout << "⏳ Waiting on data: " << std::setprecision(1) << loader.wait_seconds() * 1e3 << " ms\n";
+            std::cout << "🕳️  Non-zero inputs - fc1: " << std::setprecision(1) << fc1_density / steps * 100.0
+                      << "%, fc2: " << fc2_density / steps * 100.0 << "%\n";
+        };
+        if (streaming)
+            run_epoch(*streaming);
+        else
+            run_epoch(*loader);
+        report_checkpoint(checkpointer.snapshot());
     }
 
-    std::cout << "\n💾 Saving model to 'trained_model'...\n";
-    save_model(model, "trained_model");
+    std::cout << "\n📏 Peak RSS: " << std::setprecision(1) << peak_rss_mb() << " MB\n";
+    std::cout << "💾 Waiting for the last checkpoint...\n";
+    checkpointer.flush();
+    std::cout << "💾 Saved 'trained_model.ckpt': " << checkpointer.written() << " checkpoint(s) written in "
+              << std::setprecision(1) << checkpointer.write_seconds() * 1e3 << " ms of background wall time, training stalled "
+              << std::setprecision(2) << checkpointer.stall_seconds() * 1e3 << " ms in total\n";
     return 0;
 }
@@ -3,6 +3,8 @@
 
 #include "layers.h"
 #include "loss.h"
+#include "workspace.h"
+#include "optimizer.h"
 #include <vector>
 #include <algorithm>
 #include <iostream>
@@ -12,6 +14,8 @@ public:
     Conv2D c1;
     ReLU r1;
     MaxPool2D p1;
+    ConvReLUPool c1_block;  // fused c1 → r1 → p1, see conv_fused()
+    bool fuse_conv_block = true;
     Flatten flat;
 
     Dense fc1;       // ⬅️ Hidden layer (1690 → 128)
@@ -19,7 +23,19 @@ public:
     Dense fc2;       // ⬅️ Output layer (128 → 10)
 
     SoftmaxCrossEntropy loss_fn;
-    std::vector<std::vector<double>> logits;
+
+    // Every weight and bias, and every parameter gradient, in one block
+    // each: c1, fc1, fc2, weights before biases. The layers' weights/biases
+    // and dw/db/d_weights/d_biases are views into these, so an Optimizer
+    // updates the whole model in one pass. CNN is not copyable for that reason.
+    AlignedVector<double> parameters, gradients;
+
+    // Activations and gradients for every layer live here. Sized for the
+    // first batch shape seen and re-carved (not reallocated) when the batch
+    // shrinks, e.g. for the last partial batch of an epoch.
+    Workspace workspace;
+    int bound_batch = 0, bound_h = 0, bound_w = 0;
+    bool bound_fused = false;
 
     CNN()
         : c1(1, 10, 3),
@@ -29,46 +45,204 @@ public:
           fc1(13 * 13 * 10, 128), // 1690 → 128
           r2(),
           fc2(128, 10)            // 128 → 10
-    {}
+    {
+        c1.needs_input_grad = false; // nothing consumes the gradient w.r.t. the image
+        fc1.zero_inputs_discard_grad = true; // fed by max-pool over ReLU
+        fc2.zero_inputs_discard_grad = true; // fed by ReLU
+        gather_parameters();
+        weights_changed();
+    }
+
+    CNN(const CNN&) = delete;
+    CNN& operator=(const CNN&) = delete;
+
+    // Call after writing `parameters` (an optimizer step, a load, a copy)
+    void weights_changed() {
+        c1.weights_changed();
+        fc1.weights_changed();
+        fc2.weights_changed();
+    }
+
+    // Packs the dense layers' weights now, so predict() runs on the packed
+    // GEMM rather than falling back to gemm() until the next forward()
+    void prepare_inference() {
+        fc1.pack_weights();
+        fc2.pack_weights();
+    }
+
+    void bind(const Tensor4D& x) {
+        if (x.dim(0) == bound_batch && x.dim(2) == bound_h && x.dim(3) == bound_w &&
+            conv_fused() == bound_fused)
+            return;
+        workspace.rewind();
+        bind_layers(x);
+        if (workspace.overflowed()) {
+            workspace.reserve(workspace.requested());
+            bind_layers(x);
+        }
+        bound_batch = x.dim(0);
+        bound_h = x.dim(2);
+        bound_w = x.dim(3);
+        bound_fused = conv_fused();
+    }
+
+    // c1 → r1 → p1 run as c1_block: when fuse_conv_block is set and c1's
+    // backend is one the block implements (Simd3x3, Direct); Im2col and
+    // Winograd run through the separate layers so the choice still applies
+    bool conv_fused() const { return fuse_conv_block && ConvReLUPool::fuses(c1); }
 
     double forward(const Tensor4D& x, const std::vector<int>& y) {
-        Tensor4D out = c1.forward(x);
-        out = r1.forward(out);
-        out = p1.forward(out);
-        std::vector<std::vector<double>> flat_out = flat.forward(out);
-        auto hidden = fc1.forward(flat_out);
-        auto activated = r2.forward(hidden);
-        logits = fc2.forward(activated);
-        return loss_fn.forward(logits, y);
+        return loss_fn.forward(logits(x), y);
     }
 
-    void backward(double lr) {
-        auto grad = loss_fn.backward();
-        grad = fc2.backward(grad, lr);
-        grad = r2.backward(grad, lr);
-        grad = fc1.backward(grad, lr);
-        Tensor4D grad4D = flat.backward(grad);
-        grad4D = p1.backward(grad4D, lr);
-        grad4D = r1.backward(grad4D, lr);
-        c1.backward(grad4D, lr);
-    }
-
-    std::vector<int> predict(const Tensor4D& x) {
-        Tensor4D out = c1.forward(x);
-        out = r1.forward(out);
-        out = p1.forward(out);
-        auto flat_out = flat.forward(out);
-        auto hidden = fc1.forward(flat_out);
-        auto activated = r2.forward(hidden);
-        auto out3 = fc2.forward(activated);
-
-        std::vector<int> predictions(out3.size());
-        for (size_t i = 0; i < out3.size(); ++i) {
-            auto& row = out3[i];
-            predictions[i] = std::distance(row.begin(), std::max_element(row.begin(), row.end()));
+    // Fills `gradients` for the last forward(); the weights are untouched
+    void backward() {
+        const Matrix& grad = loss_fn.backward();
+        const Matrix& g_fc2 = fc2.backward(grad);
+        const Matrix& g_r2 = r2.backward(g_fc2);
+        const Matrix& g_fc1 = fc1.backward(g_r2);
+        const Tensor4D& g_flat = flat.backward(g_fc1);
+        if (conv_fused()) {
+            c1_block.backward(c1, g_flat);
+            return;
         }
+        const Tensor4D& g_p1 = p1.backward(g_flat);
+        const Tensor4D& g_r1 = r1.backward(g_p1);
+        c1.backward(g_r1);
+    }
+
+    // One optimizer step over all parameters from the current gradients
+    void update(Optimizer& optimizer) {
+        optimizer.step(parameters.data(), gradients.data(), parameters.size());
+        weights_changed();
+    }
+
+    // Plain SGD shorthand: backward() then w -= lr·g
+    void backward(double lr) {
+        backward();
+        Optimizer sgd = Optimizer::sgd(lr);
+        update(sgd);
+    }
+
+    // Class of each image, through the layers' const infer() path: nothing
+    // is cached for backward and neither the workspace nor the layers are
+    // touched, so several threads may call predict() on one model at once
+    // (while nobody trains it). Images go through infer_chunk at a time;
+    // each call carves its own scratch holding one chunk's activations.
+    static constexpr int infer_chunk = 64;
+
+    std::vector<int> predict(const Tensor4D& x) const {
+        std::vector<int> predictions(x.dim(0));
+        Workspace ws;
+        predict(x, predictions.data(), ws);
         return predictions;
     }
+
+    // Same, into caller storage and with a caller-owned workspace (grown
+    // here when too small), so a thread calling it repeatedly allocates
+    // only on the first call
+    void predict(const Tensor4D& x, int* predictions, Workspace& ws) const {
+        int batch = x.dim(0);
+        if (batch == 0) return;
+        std::size_t scratch = infer_scratch_size(std::min(batch, infer_chunk), x.dim(2), x.dim(3));
+        if (ws.capacity() < scratch) ws.reserve(scratch);
+
+        for (int b0 = 0; b0 < batch; b0 += infer_chunk) {
+            int n = std::min(infer_chunk, batch - b0);
+            Tensor4D chunk = Tensor4D::view(const_cast<double*>(x.sample(b0)), n, x.dim(1), x.dim(2), x.dim(3));
+            ws.rewind();
+            Matrix out3 = infer_logits(ws, chunk);
+            int classes = out3.dim(1);
+            for (int i = 0; i < n; ++i) {
+                const double* row = out3.sample(i);
+                predictions[b0 + i] = std::distance(row, std::max_element(row, row + classes));
+            }
+        }
+    }
+
+    // Doubles of scratch predict() uses for a chunk of n images
+    std::size_t infer_scratch_size(int n, int h, int w) const {
+        Workspace dry; // takes nothing, only counts
+        Tensor4D shape = Tensor4D::view(nullptr, n, c1.in_channels, h, w);
+        infer_logits(dry, shape);
+        return dry.requested();
+    }
+
+private:
+    void gather_parameters() {
+        Tensor* values[] = {&c1.weights, &c1.biases, &fc1.weights, &fc1.biases, &fc2.weights, &fc2.biases};
+        Tensor* grads[] = {&c1.dw, &c1.db, &fc1.d_weights, &fc1.d_biases, &fc2.d_weights, &fc2.d_biases};
+        std::size_t total = 0;
+        for (Tensor* t : values) total += t->size();
+        parameters.assign(total, 0.0);
+        gradients.assign(total, 0.0);
+
+        std::size_t offset = 0;
+        for (int i = 0; i < 6; ++i) {
+            double* value = parameters.data() + offset;
+            std::copy(values[i]->begin(), values[i]->end(), value);
+            *values[i] = Tensor::view_like(value, *values[i]);
+            *grads[i] = Tensor::view_like(gradients.data() + offset, *grads[i]);
+            offset += values[i]->size();
+        }
+    }
+
+    // The forward pass through infer(), activations carved out of ws. On a
+    // dry run (ws too small) only the buffer sizes are recorded.
+    Matrix infer_logits(Workspace& ws, const Tensor4D& x) const {
+        int n = x.dim(0);
+        int conv_h = x.dim(2) - c1.kernel_size + 1, conv_w = x.dim(3) - c1.kernel_size + 1;
+        Tensor4D pooled = ws.take(n, c1.out_channels, conv_h / 2, conv_w / 2);
+        Matrix hidden = ws.take(n, fc1.weights.dim(1));
+        Matrix out = ws.take(n, fc2.weights.dim(1));
+        if (conv_fused()) {
+            double* strip = ws.take(static_cast<int>(ConvReLUPool::infer_scratch_size(c1, x.dim(3)))).data();
+            if (ws.overflowed()) return out;
+            c1_block.infer(c1, x, pooled, strip);
+        } else {
+            Tensor4D conv = ws.take(n, c1.out_channels, conv_h, conv_w);
+            double* scratch = ws.take(static_cast<int>(c1.infer_scratch_size(x.dim(2), x.dim(3)))).data();
+            if (ws.overflowed()) return out;
+            c1.infer(x, conv, scratch);
+            r1.infer(conv, conv);
+            p1.infer(conv, pooled);
+        }
+        fc1.infer(Flatten::infer(pooled), hidden);
+        r2.infer(hidden, hidden);
+        fc2.infer(hidden, out);
+        return out;
+    }
+
+    const Matrix& logits(const Tensor4D& x) {
+        bind(x);
+        const Tensor4D& pooled = conv_fused() ? c1_block.forward(c1, x) : conv_block(x);
+        const Matrix& flat_out = flat.forward(pooled);
+        const Matrix& hidden = fc1.forward(flat_out);
+        const Matrix& activated = r2.forward(hidden);
+        return fc2.forward(activated);
+    }
+
+    const Tensor4D& conv_block(const Tensor4D& x) {
+        const Tensor4D& conv = c1.forward(x);
+        const Tensor4D& act = r1.forward(conv);
+        return p1.forward(act);
+    }
+
+    void bind_layers(const Tensor4D& x) {
+        c1.bind(workspace, x);
+        if (conv_fused()) {
+            c1_block.bind(workspace, c1, x);
+            flat.bind(workspace, c1_block.output);
+        } else {
+            r1.bind(workspace, c1.output);
+            p1.bind(workspace, r1.output);
+            flat.bind(workspace, p1.output);
+        }
+        fc1.bind(workspace, flat.output);
+        r2.bind(workspace, fc1.output);
+        fc2.bind(workspace, r2.output);
+        loss_fn.bind(workspace, fc2.output);
+    }
 };
 
 #endif
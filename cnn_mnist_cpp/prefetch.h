@@ -0,0 +1,146 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include "dataset.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <cstdint>
+
+// ───────────────────────────
+// PrefetchLoader
+// Same interface as DataLoader, but batches are gathered by background
+// loader threads while the caller trains on the previous one. Batch k
+// lives in slot k % slots; with the default three slots the caller holds
+// batch k while batches k+1 and k+2 are being prepared. A slot is reused
+// only after the caller has moved past the batch in it (backpressure), so
+// loaders never run more than slots − 1 batches ahead.
+//
+// start_epoch() waits for loaders still busy with the previous epoch, so
+// an epoch may be abandoned early. The destructor stops and joins them.
+// The returned batch is only valid until the next call to next().
+class PrefetchLoader {
+public:
+    PrefetchLoader(const Dataset& data, int batch_size, bool shuffle = true,
+                   std::uint32_t seed = std::random_device{}(), int loaders = 1, int slots = 3)
+        : data_(data), batch_size_(batch_size), shuffle_(shuffle), gen_(seed), order_(data.size()) {
+        std::iota(order_.begin(), order_.end(), 0);
+        slots_.resize(std::max(2, slots));
+        for (Slot& s : slots_) {
+            s.x = Tensor4D(batch_size_, data.channels, data.height, data.width);
+            s.y.resize(batch_size_);
+        }
+        for (int t = 0; t < std::max(1, loaders); ++t)
+            loaders_.emplace_back([this] { loader_loop(); });
+    }
+
+    ~PrefetchLoader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_.notify_all();
+        for (std::thread& t : loaders_) t.join();
+    }
+
+    PrefetchLoader(const PrefetchLoader&) = delete;
+    PrefetchLoader& operator=(const PrefetchLoader&) = delete;
+
+    int batch_size() const { return batch_size_; }
+    std::size_t steps() const { return (order_.size() + batch_size_ - 1) / batch_size_; }
+    const std::vector<int>& order() const { return order_; }
+
+    // Seconds next() spent blocked on a batch that was not ready yet,
+    // since the last start_epoch()
+    double wait_seconds() const { return wait_seconds_; }
+
+    // Reshuffle the order (when shuffling), rewind, and let loaders start
+    void start_epoch() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return busy_ == 0; });
+        if (shuffle_) std::shuffle(order_.begin(), order_.end(), gen_);
+        for (Slot& s : slots_) s.batch = -1;
+        total_ = static_cast<long>(steps());
+        claimed_ = next_ = released_ = 0;
+        wait_seconds_ = 0.0;
+        lock.unlock();
+        work_.notify_all();
+    }
+
+    // Hand out the next mini-batch; false once the epoch is done
+    bool next(Batch& batch) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        released_ = next_; // the caller is done with the batch handed out last
+        work_.notify_all();
+        if (next_ >= total_) return false;
+
+        Slot& s = slots_[next_ % slots_.size()];
+        if (s.batch != next_) {
+            auto t0 = std::chrono::steady_clock::now();
+            ready_.wait(lock, [&] { return s.batch == next_; });
+            wait_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        }
+        ++next_;
+        lock.unlock();
+
+        batch.x = Tensor4D::view(s.x.data(), s.n, data_.channels, data_.height, data_.width);
+        batch.y.assign(s.y.begin(), s.y.begin() + s.n);
+        return true;
+    }
+
+private:
+    struct Slot {
+        Tensor4D x;
+        std::vector<int> y;
+        int n = 0;
+        long batch = -1; // which batch of the epoch the slot holds, once ready
+    };
+
+    const Dataset& data_;
+    int batch_size_;
+    bool shuffle_;
+    std::mt19937 gen_;
+    std::vector<int> order_;
+    std::vector<Slot> slots_;
+    std::vector<std::thread> loaders_;
+
+    std::mutex mutex_;
+    std::condition_variable work_, ready_, idle_;
+    long total_ = 0;     // batches this epoch
+    long claimed_ = 0;   // next batch a loader will take
+    long next_ = 0;      // next batch the caller will take
+    long released_ = 0;  // batches < released_ no longer hold a slot
+    int busy_ = 0;       // loaders filling a slot right now
+    bool stopping_ = false;
+    double wait_seconds_ = 0.0;
+
+    void loader_loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            work_.wait(lock, [this] {
+                return stopping_ || (claimed_ < total_ && claimed_ < released_ + long(slots_.size()));
+            });
+            if (stopping_) return;
+            long k = claimed_++;
+            ++busy_;
+            lock.unlock();
+
+            Slot& s = slots_[k % slots_.size()];
+            std::size_t begin = std::size_t(k) * batch_size_;
+            s.n = static_cast<int>(std::min<std::size_t>(batch_size_, order_.size() - begin));
+            data_.gather(order_.data() + begin, s.n, s.x.data(), s.y.data());
+
+            lock.lock();
+            s.batch = k;
+            if (--busy_ == 0) idle_.notify_all();
+            ready_.notify_all();
+        }
+    }
+};
+
+#endif
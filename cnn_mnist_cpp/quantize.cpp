@@ -0,0 +1,83 @@
+#include "quantized.h"
+#include "evaluation.h"
+#include "binary_dataset.h"
+#include "data_loader.h"
+#include "utils.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <filesystem>
+
+// Post-training int8 quantization of the saved model: activation scales
+// are calibrated on a balanced sample of training images (50 per digit),
+// then the test set is classified by the double model and by the int8
+// engine (both single-threaded, both from the same uint8 pixels), and the
+// accuracy loss and speedup are reported.
+static double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static Dataset load_packed(const std::string& split) {
+    std::string bin = "../MNIST/" + split + ".bin";
+    if (std::filesystem::exists(bin)) {
+        MappedDataset file(bin);
+        std::vector<int> all(file.size());
+        std::iota(all.begin(), all.end(), 0);
+        return file.to_packed_dataset(all);
+    }
+    return load_csv_dataset("../MNIST/" + split + "_images.csv", "../MNIST/" + split + "_labels.csv", true);
+}
+
+int main() {
+    std::cout << "📂 Loading model...\n";
+    CNN model;
+    if (std::filesystem::exists("trained_model.ckpt")) {
+        load_model(model, "trained_model.ckpt");
+    } else {
+        std::cout << "📥 No trained_model.ckpt; importing text files trained_model_*.txt\n";
+        import_text_model(model, "trained_model");
+    }
+
+    std::cout << "📦 Loading data...\n";
+    Dataset calibration;
+    if (std::filesystem::exists("../MNIST/train.bin")) {
+        DatasetStream file("../MNIST/train.bin", 4096);
+        calibration = sample_balanced(file, 50);
+    } else {
+        Dataset train = load_packed("train");
+        calibration = train.subset(balanced_indices(train.size(), [&](int i) { return train.labels[i]; }, 50));
+    }
+    Dataset test = load_packed("test");
+
+    auto t0 = std::chrono::steady_clock::now();
+    QuantizedCNN quantized(model, calibration);
+    std::cout << "🎚️  Quantized c1, fc1, fc2 to int8 (calibrated on " << calibration.size() << " images in "
+              << std::fixed << std::setprecision(1) << seconds_since(t0) * 1e3 << " ms): pooled scale "
+              << std::setprecision(4) << quantized.pooled_scale << ", hidden scale " << quantized.hidden_scale
+              << ", int8 GEMM kernel " << (detect_simd_level() >= SimdLevel::AVX2 ? "avx2" : "scalar") << "\n";
+
+    std::cout << "🧠 Running inference on " << test.size() << " test images...\n";
+    ShardedEvaluator evaluator(model, 1);
+    t0 = std::chrono::steady_clock::now();
+    Evaluation reference = evaluator.evaluate(test);
+    double s_double = seconds_since(t0);
+
+    QuantizedCNN::Scratch scratch;
+    std::vector<int> predictions(test.size());
+    t0 = std::chrono::steady_clock::now();
+    quantized.predict(test.pixels.data(), test.size(), predictions.data(), scratch);
+    double s_int8 = seconds_since(t0);
+
+    long correct = 0, agree = 0;
+    for (int i = 0; i < test.size(); ++i) {
+        correct += predictions[i] == test.labels[i];
+        agree += predictions[i] == reference.predictions[i];
+    }
+    double acc_double = reference.accuracy() * 100.0, acc_int8 = 100.0 * correct / test.size();
+    std::cout << "✅ Accuracy: double " << std::setprecision(4) << acc_double << "%, int8 " << acc_int8
+              << "% (loss " << std::setprecision(2) << acc_double - acc_int8 << " points, "
+              << 100.0 * agree / test.size() << "% same predictions)\n"
+              << "🚀 Throughput: double " << std::setprecision(0) << test.size() / s_double << " img/s, int8 "
+              << test.size() / s_int8 << " img/s (" << std::setprecision(2) << s_double / s_int8 << "× faster)\n";
+    return 0;
+}
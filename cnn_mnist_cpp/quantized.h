@@ -0,0 +1,374 @@
+#ifndef QUANTIZED_H
+#define QUANTIZED_H
+
+#include "model.h"
+#include "dataset.h"
+#include "conv3x3_simd.h"
+#include <vector>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// ───────────────────────────
+// Int8 GEMM
+// C (m × n16, int32) = A (m × k4, uint8) · B (k4 × n16, int8). K is padded
+// to a multiple of 4 and N to a multiple of 16; B is packed as
+// [k4 / 4][n16][4], so 8 columns × 4 consecutive k are one 32-byte row.
+// The AVX2 kernel broadcasts 4 bytes of an A row, multiplies them with 8
+// columns at once (maddubs: u8·s8 pairs summed to int16, then madd with
+// ones: pairs of those summed to int32) and keeps a 4-row × 16-column
+// block of C in registers.
+//
+// maddubs saturates int16, so activations are kept to 7 bits ([0, 127])
+// and weights to [-127, 127]: a pair then sums to at most 32258 and every
+// kernel gives exactly the same int32 result.
+struct Int8Weights {
+    int k = 0, n = 0;     // logical shape
+    int k4 = 0, n16 = 0;  // padded
+    AlignedVector<std::int8_t> packed;
+    std::vector<float> scale; // per output column: w ≈ scale · q
+
+    // Quantize k × n weights, w(i, j), symmetrically per output column
+    template <typename W>
+    static Int8Weights quantize(int k, int n, W w) {
+        Int8Weights q;
+        q.k = k;
+        q.n = n;
+        q.k4 = (k + 3) / 4 * 4;
+        q.n16 = (n + 15) / 16 * 16;
+        q.packed.assign(std::size_t(q.k4) * q.n16, 0);
+        q.scale.assign(q.n16, 0.0f);
+        for (int j = 0; j < n; ++j) {
+            double max_abs = 0.0;
+            for (int i = 0; i < k; ++i) max_abs = std::max(max_abs, std::abs(w(i, j)));
+            double s = max_abs > 0.0 ? max_abs / 127.0 : 1.0;
+            q.scale[j] = static_cast<float>(s);
+            for (int i = 0; i < k; ++i)
+                q.packed[(std::size_t(i / 4) * q.n16 + j) * 4 + i % 4] =
+                    static_cast<std::int8_t>(std::clamp(std::lround(w(i, j) / s), -127L, 127L));
+        }
+        return q;
+    }
+};
+
+// Requantize int32 sums to 7-bit activations, row by row:
+// out = clamp(round(sum · mul + add), 0, 127), per column mul/add (n16 of them)
+inline void requantize_u7_scalar(const std::int32_t* sums, int rows, int n16, const float* mul, const float* add,
+                                 std::uint8_t* out, int ldo) {
+    for (int r = 0; r < rows; ++r)
+        for (int j = 0; j < n16; ++j) {
+            float v = float(sums[std::size_t(r) * n16 + j]) * mul[j] + add[j];
+            out[std::size_t(r) * ldo + j] = static_cast<std::uint8_t>(std::lrint(std::min(std::max(v, 0.0f), 127.0f)));
+        }
+}
+
+inline void gemm_u8s8_scalar(const std::uint8_t* a, int m, int lda, const Int8Weights& b, std::int32_t* c, int ldc) {
+    for (int r = 0; r < m; ++r)
+        for (int j = 0; j < b.n16; ++j) {
+            std::int32_t acc = 0;
+            for (int i = 0; i < b.k4; ++i)
+                acc += std::int32_t(a[std::size_t(r) * lda + i]) * b.packed[(std::size_t(i / 4) * b.n16 + j) * 4 + i % 4];
+            c[std::size_t(r) * ldc + j] = acc;
+        }
+}
+
+#ifdef CONV3X3_X86
+
+template <int R>
+__attribute__((target("avx2")))
+inline void gemm_u8s8_avx2_rows(const std::uint8_t* a, int lda, const Int8Weights& b, std::int32_t* c, int ldc) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    int quads = b.k4 / 4;
+    for (int j0 = 0; j0 < b.n16; j0 += 16) {
+        __m256i acc[R][2];
+        for (int r = 0; r < R; ++r) acc[r][0] = acc[r][1] = _mm256_setzero_si256();
+        const std::int8_t* bp = b.packed.data() + std::size_t(j0) * 4;
+        for (int q = 0; q < quads; ++q, bp += std::size_t(b.n16) * 4) {
+            __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bp));
+            __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bp + 32));
+            for (int r = 0; r < R; ++r) {
+                std::int32_t quad;
+                std::memcpy(&quad, a + std::size_t(r) * lda + q * 4, 4);
+                __m256i av = _mm256_set1_epi32(quad);
+                acc[r][0] = _mm256_add_epi32(acc[r][0], _mm256_madd_epi16(_mm256_maddubs_epi16(av, b0), ones));
+                acc[r][1] = _mm256_add_epi32(acc[r][1], _mm256_madd_epi16(_mm256_maddubs_epi16(av, b1), ones));
+            }
+        }
+        for (int r = 0; r < R; ++r) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(c + std::size_t(r) * ldc + j0), acc[r][0]);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(c + std::size_t(r) * ldc + j0 + 8), acc[r][1]);
+        }
+    }
+}
+
+inline void gemm_u8s8_avx2(const std::uint8_t* a, int m, int lda, const Int8Weights& b, std::int32_t* c, int ldc) {
+    int r = 0;
+    for (; r + 4 <= m; r += 4) gemm_u8s8_avx2_rows<4>(a + std::size_t(r) * lda, lda, b, c + std::size_t(r) * ldc, ldc);
+    for (; r < m; ++r) gemm_u8s8_avx2_rows<1>(a + std::size_t(r) * lda, lda, b, c + std::size_t(r) * ldc, ldc);
+}
+
+// Same arithmetic as the scalar version (multiply then add, round to
+// nearest even), 16 columns per step
+__attribute__((target("avx2")))
+inline void requantize_u7_avx2(const std::int32_t* sums, int rows, int n16, const float* mul, const float* add,
+                               std::uint8_t* out, int ldo) {
+    const __m256 lo = _mm256_setzero_ps(), hi = _mm256_set1_ps(127.0f);
+    for (int r = 0; r < rows; ++r)
+        for (int j = 0; j < n16; j += 16) {
+            const std::int32_t* sum = sums + std::size_t(r) * n16 + j;
+            __m256 v0 = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(sum)));
+            __m256 v1 = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(sum + 8)));
+            v0 = _mm256_add_ps(_mm256_mul_ps(v0, _mm256_loadu_ps(mul + j)), _mm256_loadu_ps(add + j));
+            v1 = _mm256_add_ps(_mm256_mul_ps(v1, _mm256_loadu_ps(mul + j + 8)), _mm256_loadu_ps(add + j + 8));
+            __m256i q0 = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(v0, lo), hi));
+            __m256i q1 = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(v1, lo), hi));
+            // packs works within 128-bit lanes: (q0 lo, q1 lo, q0 hi, q1 hi), put back in order
+            __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(q0, q1), 0xD8);
+            __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + std::size_t(r) * ldo + j), bytes);
+        }
+}
+
+#endif // CONV3X3_X86
+
+using RequantizeKernel = void (*)(const std::int32_t* sums, int rows, int n16, const float* mul, const float* add,
+                                  std::uint8_t* out, int ldo);
+
+inline RequantizeKernel requantize_u7_kernel(SimdLevel level) {
+#ifdef CONV3X3_X86
+    if (level == SimdLevel::AVX2 || level == SimdLevel::AVX512) return requantize_u7_avx2;
+#endif
+    (void)level;
+    return requantize_u7_scalar;
+}
+
+inline RequantizeKernel requantize_u7_dispatch() {
+    static const RequantizeKernel kernel = requantize_u7_kernel(detect_simd_level());
+    return kernel;
+}
+
+using GemmU8S8Kernel = void (*)(const std::uint8_t* a, int m, int lda, const Int8Weights& b, std::int32_t* c, int ldc);
+
+// Kernel for a given level (AVX2 and up use the AVX2 one)
+inline GemmU8S8Kernel gemm_u8s8_kernel(SimdLevel level) {
+#ifdef CONV3X3_X86
+    if (level == SimdLevel::AVX2 || level == SimdLevel::AVX512) return gemm_u8s8_avx2;
+#endif
+    (void)level;
+    return gemm_u8s8_scalar;
+}
+
+inline GemmU8S8Kernel gemm_u8s8_dispatch() {
+    static const GemmU8S8Kernel kernel = gemm_u8s8_kernel(detect_simd_level());
+    return kernel;
+}
+
+// ───────────────────────────
+// QuantizedCNN
+// Post-training int8 version of CNN for inference. Built from a trained
+// model and a calibration sample:
+//   - weights of c1, fc1 and fc2: int8, one scale per output channel
+//   - activations: uint8 in [0, 127], one scale per tensor. The input
+//     image has a fixed scale (1/127); the pooled feature map and the
+//     hidden layer take theirs from the largest value seen when the
+//     double model runs on the calibration images.
+// Every layer is an int8 GEMM (the conv through im2col) with int32 sums;
+// the float epilogue adds the bias, applies ReLU and requantizes for the
+// next layer. Requantizing is monotonic, so max-pooling is done on the
+// uint8 conv output. The pooled map is kept channel-last, with fc1's
+// weight rows permuted to match, so it is already fc1's input row.
+class QuantizedCNN {
+public:
+    // Working buffers of one predict() call; reuse across calls
+    struct Scratch {
+        AlignedVector<std::uint8_t> levels, patches, conv, pooled, hidden;
+        AlignedVector<std::int32_t> sums;
+    };
+
+    static constexpr int chunk = CNN::infer_chunk;
+
+    int channels, height, width;
+    int conv_out, kernel_size, conv_h, conv_w, pool_h, pool_w;
+    Int8Weights conv, dense1, dense2;
+    std::vector<float> conv_bias, dense1_bias, dense2_bias;
+    float input_scale = 1.0f / 127.0f, pooled_scale = 1.0f, hidden_scale = 1.0f;
+
+    // calibration: packed images the activation scales are taken from
+    QuantizedCNN(const CNN& model, const Dataset& calibration, int h = 28, int w = 28)
+        : channels(model.c1.in_channels), height(h), width(w), conv_out(model.c1.out_channels),
+          kernel_size(model.c1.kernel_size), conv_h(h - kernel_size + 1), conv_w(w - kernel_size + 1),
+          pool_h(conv_h / 2), pool_w(conv_w / 2) {
+        const Conv2D& c1 = model.c1;
+        int k = kernel_size;
+        conv = Int8Weights::quantize(channels * k * k, conv_out, [&](int i, int o) {
+            return c1.weights(o, i / (k * k), i % (k * k) / k, i % k);
+        });
+        // fc1 rows in (y, x, channel) order instead of the flatten's (channel, y, x)
+        int plane = pool_h * pool_w;
+        dense1 = Int8Weights::quantize(plane * conv_out, model.fc1.weights.dim(1), [&](int i, int j) {
+            return model.fc1.weights((i % conv_out) * plane + i / conv_out, j);
+        });
+        dense2 = Int8Weights::quantize(model.fc2.weights.dim(0), model.fc2.weights.dim(1),
+                                       [&](int i, int j) { return model.fc2.weights(i, j); });
+        conv_bias.assign(model.c1.biases.begin(), model.c1.biases.end());
+        dense1_bias.assign(model.fc1.biases.begin(), model.fc1.biases.end());
+        dense2_bias.assign(model.fc2.biases.begin(), model.fc2.biases.end());
+        calibrate(model, calibration);
+        fold_scales();
+    }
+
+    // Class of each of n packed images (uint8, p stands for p / 255)
+    void predict(const std::uint8_t* pixels, int n, int* predictions, Scratch& s) const {
+        GemmU8S8Kernel gemm = gemm_u8s8_dispatch();
+        RequantizeKernel requantize = requantize_u7_dispatch();
+        std::size_t image = std::size_t(channels) * height * width;
+        int pixels_out = conv_h * conv_w;
+        s.patches.resize(std::size_t(pixels_out) * conv.k4);
+        s.levels.resize(image + 4);
+        s.conv.resize(std::size_t(pixels_out) * conv.n16);
+        s.pooled.resize(std::size_t(chunk) * dense1.k4);
+        s.hidden.resize(std::size_t(chunk) * dense1.n16); // padding columns come out 0
+        s.sums.resize(std::max<std::size_t>(std::size_t(pixels_out) * conv.n16, std::size_t(chunk) * dense1.n16));
+        std::fill(s.patches.begin(), s.patches.end(), 0);
+        std::fill(s.pooled.begin(), s.pooled.end(), 0);
+
+        for (int b0 = 0; b0 < n; b0 += chunk) {
+            int m = std::min(chunk, n - b0);
+            for (int b = 0; b < m; ++b) {
+                const std::uint8_t* src = pixels + (b0 + b) * image;
+                const std::uint8_t* level = input_levels();
+                for (std::size_t p = 0; p < image; ++p) s.levels[p] = level[src[p]];
+                im2col(s.levels.data(), s.patches.data());
+                gemm(s.patches.data(), pixels_out, conv.k4, conv, s.sums.data(), conv.n16);
+                // All n16 columns, padding included (its factors are 0)
+                requantize(s.sums.data(), pixels_out, conv.n16, conv_mul_.data(), conv_add_.data(), s.conv.data(),
+                           conv.n16);
+                pool(s.conv.data(), s.pooled.data() + std::size_t(b) * dense1.k4);
+            }
+
+            gemm(s.pooled.data(), m, dense1.k4, dense1, s.sums.data(), dense1.n16);
+            requantize(s.sums.data(), m, dense1.n16, dense1_mul_.data(), dense1_add_.data(), s.hidden.data(),
+                       dense1.n16);
+
+            gemm(s.hidden.data(), m, dense1.n16, dense2, s.sums.data(), dense2.n16);
+            for (int b = 0; b < m; ++b) {
+                int best = 0;
+                float best_logit = 0.0f;
+                for (int j = 0; j < dense2.n; ++j) {
+                    float logit = s.sums[std::size_t(b) * dense2.n16 + j] * dense2_mul_[j] + dense2_bias[j];
+                    if (j == 0 || logit > best_logit) {
+                        best = j;
+                        best_logit = logit;
+                    }
+                }
+                predictions[b0 + b] = best;
+            }
+        }
+    }
+
+    std::vector<int> predict(const std::uint8_t* pixels, int n) const {
+        std::vector<int> predictions(n);
+        Scratch s;
+        predict(pixels, n, predictions.data(), s);
+        return predictions;
+    }
+
+    std::vector<int> predict(const Dataset& packed) const { return predict(packed.pixels.data(), packed.size()); }
+
+private:
+    // Requantization folded into one multiply-add per value:
+    // next = sum · mul + add, in units of the next layer's scale (logits: real units)
+    std::vector<float> conv_mul_, conv_add_, dense1_mul_, dense1_add_, dense2_mul_;
+
+    void fold_scales() {
+        conv_mul_.assign(conv.n16, 0.0f);
+        conv_add_.assign(conv.n16, 0.0f);
+        for (int o = 0; o < conv_out; ++o) {
+            conv_mul_[o] = input_scale * conv.scale[o] / pooled_scale;
+            conv_add_[o] = conv_bias[o] / pooled_scale;
+        }
+        dense1_mul_.assign(dense1.n16, 0.0f);
+        dense1_add_.assign(dense1.n16, 0.0f);
+        for (int j = 0; j < dense1.n; ++j) {
+            dense1_mul_[j] = pooled_scale * dense1.scale[j] / hidden_scale;
+            dense1_add_[j] = dense1_bias[j] / hidden_scale;
+        }
+        dense2_mul_.resize(dense2.n);
+        for (int j = 0; j < dense2.n; ++j) dense2_mul_[j] = hidden_scale * dense2.scale[j];
+    }
+
+    // Input byte p (p / 255) as a 7-bit activation at input_scale
+    static const std::uint8_t* input_levels() {
+        static const std::array<std::uint8_t, 256> table = [] {
+            std::array<std::uint8_t, 256> t{};
+            for (int p = 0; p < 256; ++p) t[p] = static_cast<std::uint8_t>(std::lround(p * 127.0 / 255.0));
+            return t;
+        }();
+        return table.data();
+    }
+
+    // One image's k×k patches (x already in 7-bit levels), one row per
+    // output pixel, in (channel, ky, kx) order. For k ≤ 4 each kernel row
+    // is one fixed 4-byte copy: the extra byte lands on the next run or
+    // in the row's padding, whose weights are 0 (x has 4 spare bytes).
+    void im2col(const std::uint8_t* x, std::uint8_t* patches) const {
+        int k = kernel_size;
+        bool word = k <= 4 && channels * k * k + 4 - k <= conv.k4;
+        for (int i = 0; i < conv_h; ++i)
+            for (int j = 0; j < conv_w; ++j) {
+                std::uint8_t* row = patches + std::size_t(i * conv_w + j) * conv.k4;
+                for (int c = 0; c < channels; ++c)
+                    for (int ky = 0; ky < k; ++ky, row += k) {
+                        const std::uint8_t* src = x + (std::size_t(c) * height + i + ky) * width + j;
+                        if (word) std::memcpy(row, src, 4);
+                        else std::memcpy(row, src, k);
+                    }
+            }
+    }
+
+    // 2×2 max-pool of the channel-last conv output (n16 channels, padding
+    // included) into a channel-last row of conv_out
+    void pool(const std::uint8_t* conv_map, std::uint8_t* out) const {
+        for (int i = 0; i < pool_h; ++i)
+            for (int j = 0; j < pool_w; ++j) {
+                const std::uint8_t* p00 = conv_map + std::size_t(2 * i * conv_w + 2 * j) * conv.n16;
+                const std::uint8_t* p01 = p00 + conv.n16;
+                const std::uint8_t* p10 = p00 + std::size_t(conv_w) * conv.n16;
+                const std::uint8_t* p11 = p10 + conv.n16;
+                std::uint8_t* dst = out + std::size_t(i * pool_w + j) * conv_out;
+                for (int c = 0; c < conv_out; ++c) dst[c] = std::max(std::max(p00[c], p01[c]), std::max(p10[c], p11[c]));
+            }
+    }
+
+    // Activation scales from the double model's largest pooled and hidden
+    // values over the calibration images
+    void calibrate(const CNN& model, const Dataset& calibration) {
+        int n = calibration.size();
+        Tensor4D x(chunk, channels, height, width);
+        Tensor4D pooled(chunk, conv_out, pool_h, pool_w);
+        Matrix hidden(chunk, model.fc1.weights.dim(1));
+        std::vector<double> strip(ConvReLUPool::infer_scratch_size(model.c1, width));
+        std::vector<int> idx(chunk);
+        std::vector<int> y(chunk);
+        double max_pooled = 0.0, max_hidden = 0.0;
+        for (int b0 = 0; b0 < n; b0 += chunk) {
+            int m = std::min(chunk, n - b0);
+            for (int b = 0; b < m; ++b) idx[b] = b0 + b;
+            calibration.gather(idx.data(), m, x.data(), y.data());
+            Tensor4D xs = Tensor4D::view(x.data(), m, channels, height, width);
+            Tensor4D ps = Tensor4D::view(pooled.data(), m, conv_out, pool_h, pool_w);
+            Matrix hs = Matrix::view(hidden.data(), m, hidden.dim(1));
+            model.c1_block.infer(model.c1, xs, ps, strip.data());
+            model.fc1.infer(Flatten::infer(ps), hs);
+            model.r2.infer(hs, hs);
+            max_pooled = std::max(max_pooled, *std::max_element(ps.begin(), ps.end()));
+            max_hidden = std::max(max_hidden, *std::max_element(hs.begin(), hs.end()));
+        }
+        if (max_pooled > 0.0) pooled_scale = static_cast<float>(max_pooled / 127.0);
+        if (max_hidden > 0.0) hidden_scale = static_cast<float>(max_hidden / 127.0);
+    }
+};
+
+#endif
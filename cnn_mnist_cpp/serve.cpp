@@ -0,0 +1,77 @@
+#include "inference_server.h"
+#include "utils.h"
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <csignal>
+#include <exception>
+#include <pthread.h>
+
+// Inference daemon: loads the model once, then classifies images sent
+// over a Unix domain socket (protocol in inference_server.h), batching
+// concurrent requests. Stops on SIGINT / SIGTERM.
+// ./serve [--socket=PATH]       default /tmp/cnn_mnist.sock
+//         [--max-batch=N]       images per batch, default 64
+//         [--max-delay-us=N]    longest a request waits for its batch to fill, default 2000
+//         [--workers=N]         batches run at once, default one per core
+int main(int argc, char** argv) {
+    std::string socket_path = "/tmp/cnn_mnist.sock";
+    BatchingOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--socket=", 0) == 0) socket_path = arg.substr(9);
+        else if (arg.rfind("--max-batch=", 0) == 0) options.max_batch = std::stoi(arg.substr(12));
+        else if (arg.rfind("--max-delay-us=", 0) == 0) options.max_delay_us = std::stoi(arg.substr(15));
+        else if (arg.rfind("--workers=", 0) == 0) options.workers = std::stoi(arg.substr(10));
+    }
+
+    // Signals are taken by a thread of our own with sigwait, so the
+    // shutdown runs as ordinary code; every thread started below inherits
+    // the blocked mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    std::cout << "📂 Loading model...\n";
+    CNN model;
+    if (std::filesystem::exists("trained_model.ckpt")) {
+        load_model(model, "trained_model.ckpt");
+    } else {
+        std::cout << "📥 No trained_model.ckpt; importing text files trained_model_*.txt\n";
+        import_text_model(model, "trained_model");
+    }
+
+    try {
+        InferenceServer server(model, socket_path, options);
+        std::thread waiter([&] {
+            int signal;
+            sigwait(&signals, &signal);
+            server.stop();
+        });
+        std::cout << "🛰️  Serving on " << socket_path << " (batches up to " << options.max_batch << ", waiting at most "
+                  << options.max_delay_us << " µs, " << options.workers << " workers)\n";
+        // serve() returns once the waiter has called stop(), or throws; in
+        // the latter case the waiter is still in sigwait and gets a SIGTERM
+        // of its own so it can be joined
+        std::exception_ptr failed;
+        try {
+            server.serve();
+        } catch (...) {
+            failed = std::current_exception();
+        }
+        pthread_kill(waiter.native_handle(), SIGTERM);
+        waiter.join();
+        if (failed) std::rethrow_exception(failed);
+
+        const DynamicBatcher& batcher = server.batcher();
+        std::cout << "\n👋 Stopped after " << server.connections_served() << " connections, " << batcher.requests()
+                  << " requests in " << batcher.batches() << " batches (mean " << std::fixed << std::setprecision(1)
+                  << batcher.mean_batch() << ")\n";
+    } catch (const std::exception& e) {
+        std::cout << "❌ " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
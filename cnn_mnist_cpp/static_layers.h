@@ -0,0 +1,213 @@
+#ifndef STATIC_LAYERS_H
+#define STATIC_LAYERS_H
+
+#include "layers.h"
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// ───────────────────────────
+// Shape-specialized layers. Every size is a template parameter, so all
+// loop bounds are constexpr: the compiler unrolls the kernel loops and
+// vectorizes the rest without runtime shape checks. Weights live in
+// fixed-size std::arrays inside the layer; activations are raw pointers
+// into buffers owned by the caller (see fixed::CNN). Only the batch size
+// stays a runtime argument.
+//
+// These sit alongside the dynamic layers in layers.h and use the same
+// weight layouts, so weights can be copied across (fixed::CNN::load_from).
+namespace fixed {
+
+// ───────────────────────────
+// Conv2D<InC, OutC, K, H, W>: stride 1, no padding
+template <int InC, int OutC, int K, int H, int W>
+class Conv2D {
+public:
+    static constexpr int OutH = H - K + 1;
+    static constexpr int OutW = W - K + 1;
+    static constexpr int InSize = InC * H * W;
+    static constexpr int OutSize = OutC * OutH * OutW;
+
+    alignas(64) std::array<double, OutC * InC * K * K> weights; // (out, in, k, k)
+    std::array<double, OutC> biases{};
+    alignas(64) std::array<double, OutC * InC * K * K> dw;
+
+    Conv2D() {
+        double stddev = std::sqrt(2.0 / (InC * K * K));
+        for (double& w : weights) w = randn(stddev);
+    }
+
+    static constexpr int widx(int o, int c, int m, int n) { return ((o * InC + c) * K + m) * K + n; }
+
+    void forward(const double* x, double* out, int batch) const {
+        for (int b = 0; b < batch; ++b) {
+            const double* xb = x + b * InSize;
+            double* ob = out + b * OutSize;
+            for (int o = 0; o < OutC; ++o) {
+                double* plane = ob + o * OutH * OutW;
+                for (int p = 0; p < OutH * OutW; ++p) plane[p] = biases[o];
+                for (int c = 0; c < InC; ++c)
+                    for (int m = 0; m < K; ++m)
+                        for (int n = 0; n < K; ++n) {
+                            double wv = weights[widx(o, c, m, n)];
+                            for (int i = 0; i < OutH; ++i) {
+                                const double* src = xb + (c * H + i + m) * W + n;
+                                double* dst = plane + i * OutW;
+                                for (int j = 0; j < OutW; ++j) dst[j] += wv * src[j];
+                            }
+                        }
+            }
+        }
+    }
+
+    // d_x may be null when the input gradient is not needed
+    void backward(const double* x, const double* d_out, double* d_x, double lr, int batch) {
+        dw.fill(0.0);
+        std::array<double, OutC> db{};
+        if (d_x)
+            for (int k = 0; k < batch * InSize; ++k) d_x[k] = 0.0;
+
+        for (int b = 0; b < batch; ++b) {
+            const double* xb = x + b * InSize;
+            const double* gb = d_out + b * OutSize;
+            for (int o = 0; o < OutC; ++o) {
+                const double* g = gb + o * OutH * OutW;
+                for (int p = 0; p < OutH * OutW; ++p) db[o] += g[p];
+                for (int c = 0; c < InC; ++c)
+                    for (int m = 0; m < K; ++m)
+                        for (int n = 0; n < K; ++n) {
+                            double acc = 0.0;
+                            for (int i = 0; i < OutH; ++i) {
+                                const double* src = xb + (c * H + i + m) * W + n;
+                                for (int j = 0; j < OutW; ++j) acc += g[i * OutW + j] * src[j];
+                            }
+                            dw[widx(o, c, m, n)] += acc;
+                            if (!d_x) continue;
+                            double wv = weights[widx(o, c, m, n)];
+                            for (int i = 0; i < OutH; ++i) {
+                                double* dst = d_x + b * InSize + (c * H + i + m) * W + n;
+                                for (int j = 0; j < OutW; ++j) dst[j] += wv * g[i * OutW + j];
+                            }
+                        }
+            }
+        }
+
+        for (std::size_t k = 0; k < weights.size(); ++k) weights[k] -= lr * dw[k];
+        for (int o = 0; o < OutC; ++o) biases[o] -= lr * db[o];
+    }
+};
+
+// ───────────────────────────
+// ReLU over `n` values; the mask is recovered from the output in backward
+inline void relu_forward(const double* x, double* out, int n) {
+    for (int k = 0; k < n; ++k) out[k] = x[k] > 0.0 ? x[k] : 0.0;
+}
+
+inline void relu_backward(const double* out, const double* d_out, double* d_x, int n) {
+    for (int k = 0; k < n; ++k) d_x[k] = out[k] > 0.0 ? d_out[k] : 0.0;
+}
+
+// ───────────────────────────
+// MaxPool2D<P>: P×P windows, stride P. The argmax of each window is kept
+// as a byte (m·P + n) instead of a full-size mask.
+template <int P>
+class MaxPool2D {
+public:
+    template <int C, int H, int W>
+    static void forward(const double* x, double* out, std::uint8_t* argmax, int batch) {
+        constexpr int OutH = H / P, OutW = W / P;
+        for (int bc = 0; bc < batch * C; ++bc) {
+            const double* src = x + bc * H * W;
+            double* dst = out + bc * OutH * OutW;
+            std::uint8_t* arg = argmax + bc * OutH * OutW;
+            for (int i = 0; i < OutH; ++i)
+                for (int j = 0; j < OutW; ++j) {
+                    double best = -1e9;
+                    int best_k = 0;
+                    for (int m = 0; m < P; ++m)
+                        for (int n = 0; n < P; ++n) {
+                            double v = src[(i * P + m) * W + j * P + n];
+                            if (v > best) {
+                                best = v;
+                                best_k = m * P + n;
+                            }
+                        }
+                    dst[i * OutW + j] = best;
+                    arg[i * OutW + j] = static_cast<std::uint8_t>(best_k);
+                }
+        }
+    }
+
+    template <int C, int H, int W>
+    static void backward(const double* d_out, const std::uint8_t* argmax, double* d_x, int batch) {
+        constexpr int OutH = H / P, OutW = W / P;
+        for (int k = 0; k < batch * C * H * W; ++k) d_x[k] = 0.0;
+        for (int bc = 0; bc < batch * C; ++bc) {
+            const double* g = d_out + bc * OutH * OutW;
+            const std::uint8_t* arg = argmax + bc * OutH * OutW;
+            double* dst = d_x + bc * H * W;
+            for (int i = 0; i < OutH; ++i)
+                for (int j = 0; j < OutW; ++j) {
+                    int k = arg[i * OutW + j];
+                    dst[(i * P + k / P) * W + j * P + k % P] = g[i * OutW + j];
+                }
+        }
+    }
+};
+
+// ───────────────────────────
+// Dense<In, Out>: weights (in, out), like the dynamic Dense
+template <int In, int Out>
+class Dense {
+public:
+    alignas(64) std::array<double, In * Out> weights;
+    std::array<double, Out> biases{};
+    alignas(64) std::array<double, In * Out> d_weights;
+
+    Dense() {
+        double stddev = std::sqrt(2.0 / In);
+        for (double& w : weights) w = randn(stddev);
+    }
+
+    // out[b] = biases + x[b] · W, swept along contiguous weight rows
+    void forward(const double* x, double* out, int batch) const {
+        for (int b = 0; b < batch; ++b) {
+            double* o = out + b * Out;
+            for (int j = 0; j < Out; ++j) o[j] = biases[j];
+            for (int i = 0; i < In; ++i) {
+                double xv = x[b * In + i];
+                const double* row = weights.data() + i * Out;
+                for (int j = 0; j < Out; ++j) o[j] += xv * row[j];
+            }
+        }
+    }
+
+    // d_x may be null when the input gradient is not needed
+    void backward(const double* x, const double* d_out, double* d_x, double lr, int batch) {
+        d_weights.fill(0.0);
+        std::array<double, Out> d_biases{};
+        for (int b = 0; b < batch; ++b) {
+            const double* g = d_out + b * Out;
+            for (int j = 0; j < Out; ++j) d_biases[j] += g[j];
+            for (int i = 0; i < In; ++i) {
+                double xv = x[b * In + i];
+                double* row = d_weights.data() + i * Out;
+                for (int j = 0; j < Out; ++j) row[j] += xv * g[j];
+            }
+            if (!d_x) continue;
+            for (int i = 0; i < In; ++i) {
+                const double* row = weights.data() + i * Out;
+                double acc = 0.0;
+                for (int j = 0; j < Out; ++j) acc += g[j] * row[j];
+                d_x[b * In + i] = acc;
+            }
+        }
+
+        for (std::size_t k = 0; k < weights.size(); ++k) weights[k] -= lr * d_weights[k];
+        for (int j = 0; j < Out; ++j) biases[j] -= lr * d_biases[j];
+    }
+};
+
+} // namespace fixed
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef STATIC_MODEL_H
+#define STATIC_MODEL_H
+
+#include "static_layers.h"
+#include "model.h"
+#include <array>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace fixed {
+
+// ───────────────────────────
+// The host CNN with every shape fixed at compile time:
+// Conv2D(1→10, 3×3) on 28×28 → ReLU → MaxPool 2×2 → Dense 1690→128 → ReLU → Dense 128→10.
+// All activation buffers are std::arrays sized for MaxBatch, so the object
+// is several MB: give it static storage or allocate it with new.
+template <int MaxBatch>
+class CNN {
+public:
+    using Conv = Conv2D<1, 10, 3, 28, 28>;
+    using Pool = MaxPool2D<2>;
+    static constexpr int PoolH = Conv::OutH / 2, PoolW = Conv::OutW / 2;
+    static constexpr int Flat = 10 * PoolH * PoolW;
+    static constexpr int Hidden = 128, Classes = 10;
+
+    Conv c1;
+    Dense<Flat, Hidden> fc1;
+    Dense<Hidden, Classes> fc2;
+
+    // Copy the weights of a dynamic model (same layouts)
+    void load_from(const ::CNN& model) {
+        std::copy(model.c1.weights.begin(), model.c1.weights.end(), c1.weights.begin());
+        std::copy(model.c1.biases.begin(), model.c1.biases.end(), c1.biases.begin());
+        std::copy(model.fc1.weights.begin(), model.fc1.weights.end(), fc1.weights.begin());
+        std::copy(model.fc1.biases.begin(), model.fc1.biases.end(), fc1.biases.begin());
+        std::copy(model.fc2.weights.begin(), model.fc2.weights.end(), fc2.weights.begin());
+        std::copy(model.fc2.biases.begin(), model.fc2.biases.end(), fc2.biases.begin());
+    }
+
+    // x: `batch` contiguous 28×28 images, batch ≤ MaxBatch
+    double forward(const double* x, const int* labels, int batch) {
+        if (batch < 0 || batch > MaxBatch)
+            throw std::invalid_argument("fixed::CNN::forward: batch of " + std::to_string(batch) +
+                                        " exceeds MaxBatch " + std::to_string(MaxBatch));
+        run(x, batch);
+        input = x;
+        n = batch;
+        std::copy(labels, labels + batch, y.begin());
+
+        double loss = 0.0;
+        for (int b = 0; b < batch; ++b) {
+            const double* row = logits.data() + b * Classes;
+            double* p = probs.data() + b * Classes;
+            double max_logit = *std::max_element(row, row + Classes);
+            double sum_exp = 0.0;
+            for (int j = 0; j < Classes; ++j) {
+                p[j] = std::exp(row[j] - max_logit);
+                sum_exp += p[j];
+            }
+            for (int j = 0; j < Classes; ++j) p[j] /= sum_exp;
+            loss += -std::log(p[labels[b]] + 1e-9);
+        }
+        return loss / batch;
+    }
+
+    double forward(const Tensor4D& x, const std::vector<int>& labels) {
+        return forward(x.data(), labels.data(), x.dim(0));
+    }
+
+    void backward(double lr) {
+        for (int b = 0; b < n; ++b)
+            for (int j = 0; j < Classes; ++j)
+                g_logits[b * Classes + j] = (probs[b * Classes + j] - (j == y[b] ? 1.0 : 0.0)) / n;
+
+        fc2.backward(hidden_act.data(), g_logits.data(), g_hidden.data(), lr, n);
+        relu_backward(hidden_act.data(), g_hidden.data(), g_hidden.data(), n * Hidden);
+        fc1.backward(pooled.data(), g_hidden.data(), g_pooled.data(), lr, n);
+        Pool::backward<10, Conv::OutH, Conv::OutW>(g_pooled.data(), argmax.data(), g_conv.data(), n);
+        relu_backward(conv_act.data(), g_conv.data(), g_conv.data(), n * Conv::OutSize);
+        c1.backward(input, g_conv.data(), nullptr, lr, n);
+    }
+
+    // Any number of images, MaxBatch at a time through the fixed buffers
+    std::vector<int> predict(const Tensor4D& x) {
+        int batch = x.dim(0);
+        std::vector<int> predictions(batch);
+        for (int b0 = 0; b0 < batch; b0 += MaxBatch) {
+            int chunk = std::min(MaxBatch, batch - b0);
+            run(x.sample(b0), chunk);
+            for (int b = 0; b < chunk; ++b) {
+                const double* row = logits.data() + b * Classes;
+                predictions[b0 + b] = std::max_element(row, row + Classes) - row;
+            }
+        }
+        return predictions;
+    }
+
+private:
+    const double* input = nullptr;
+    int n = 0;
+    std::array<int, MaxBatch> y{};
+
+    alignas(64) std::array<double, MaxBatch * Conv::OutSize> conv_out, conv_act, g_conv;
+    alignas(64) std::array<double, MaxBatch * Flat> pooled, g_pooled;
+    std::array<std::uint8_t, MaxBatch * Flat> argmax;
+    alignas(64) std::array<double, MaxBatch * Hidden> hidden, hidden_act, g_hidden;
+    alignas(64) std::array<double, MaxBatch * Classes> logits, probs, g_logits;
+
+    void run(const double* x, int batch) {
+        c1.forward(x, conv_out.data(), batch);
+        relu_forward(conv_out.data(), conv_act.data(), batch * Conv::OutSize);
+        Pool::forward<10, Conv::OutH, Conv::OutW>(conv_act.data(), pooled.data(), argmax.data(), batch);
+        fc1.forward(pooled.data(), hidden.data(), batch);
+        relu_forward(hidden.data(), hidden_act.data(), batch * Hidden);
+        fc2.forward(hidden_act.data(), logits.data(), batch);
+    }
+};
+
+} // namespace fixed
+
+#endif
@@ -0,0 +1,266 @@
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include "binary_dataset.h"
+#include <string>
+#include <vector>
+#include <random>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+// ───────────────────────────
+// DatasetStream
+// Sequential reader for a binary dataset file (binary_dataset.h) that may
+// be far larger than RAM. Samples are read with pread() one fixed-size
+// window at a time into a reused buffer, so memory stays at one window
+// however big the file is.
+class DatasetStream {
+public:
+    DatasetStream(const std::string& path, int window) : path_(path) {
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) throw std::runtime_error("Cannot open " + path);
+        if (::pread(fd_, &header_, sizeof(header_), 0) != ssize_t(sizeof(header_)) ||
+            std::memcmp(header_.magic, binary_dataset_magic, sizeof(header_.magic)) != 0) {
+            ::close(fd_);
+            throw std::runtime_error(path + ": not a dataset file");
+        }
+        ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+        set_window(window);
+    }
+
+    ~DatasetStream() { ::close(fd_); }
+
+    DatasetStream(const DatasetStream&) = delete;
+    DatasetStream& operator=(const DatasetStream&) = delete;
+
+    int size() const { return header_.count; }
+    int channels() const { return header_.channels; }
+    int height() const { return header_.height; }
+    int width() const { return header_.width; }
+    std::size_t sample_size() const { return std::size_t(header_.channels) * header_.height * header_.width; }
+    std::size_t window_bytes() const { return pixels_.size() + labels_.size(); }
+
+    void rewind() { next_ = 0; }
+
+    // Samples per window (at most the whole file); resizes the buffer
+    void set_window(int window) {
+        window_ = std::clamp(window, 1, std::max(1, size()));
+        pixels_.assign(std::size_t(window_) * sample_size(), 0);
+        labels_.assign(window_, 0);
+    }
+
+    // Read the next window; returns how many samples it holds (0 at the end)
+    int next_window() {
+        int n = std::min<long>(window_, long(header_.count) - next_);
+        if (n <= 0) return 0;
+        std::size_t image = sample_size();
+        read_exact(pixels_.data(), n * image, header_.pixel_offset + next_ * image);
+        read_exact(labels_.data(), n, header_.label_offset + next_);
+        next_ += n;
+        return n;
+    }
+
+    // Sample k of the current window
+    const std::uint8_t* pixels(int k) const { return pixels_.data() + k * sample_size(); }
+    int label(int k) const { return labels_[k]; }
+
+private:
+    std::string path_;
+    int fd_ = -1;
+    BinaryDatasetHeader header_;
+    int window_ = 0;
+    long next_ = 0;
+    AlignedVector<std::uint8_t> pixels_;
+    std::vector<std::uint8_t> labels_;
+
+    void read_exact(std::uint8_t* dst, std::size_t bytes, std::uint64_t offset) {
+        while (bytes > 0) {
+            ssize_t got = ::pread(fd_, dst, bytes, offset);
+            if (got <= 0) throw std::runtime_error(path_ + ": truncated");
+            dst += got;
+            bytes -= got;
+            offset += got;
+        }
+    }
+};
+
+// ───────────────────────────
+// Balanced per-class sampling in a single pass over a stream. Only the
+// kept samples are copied out of the window; rejected ones are never held.
+//   uniform = false: the first per_class samples of each digit, in file
+//                    order (select_balanced_subset's rule); stops reading
+//                    as soon as every class is full
+//   uniform = true:  a uniform random per_class of each digit, by
+//                    reservoir sampling per class (reads the whole file)
+Dataset sample_balanced(DatasetStream& stream, int per_class, bool uniform = false, std::uint32_t seed = 0) {
+    std::size_t image = stream.sample_size();
+    AlignedVector<std::uint8_t> pixels(std::size_t(10) * per_class * image);
+    std::vector<int> labels;
+    labels.reserve(10 * per_class);
+    std::vector<int> slot(10 * per_class); // class y's j-th kept sample is at slot[y·per_class + j]
+    long seen[10] = {};
+    int full = 0;
+    std::mt19937_64 gen(seed);
+
+    stream.rewind();
+    for (int n; (n = stream.next_window()) > 0 && (uniform || full < 10);) {
+        for (int k = 0; k < n; ++k) {
+            int y = stream.label(k);
+            if (y < 0 || y > 9) continue;
+            long i = seen[y]++;
+            int dst;
+            if (i < per_class) {
+                dst = static_cast<int>(labels.size());
+                slot[y * per_class + i] = dst;
+                labels.push_back(y);
+                if (i + 1 == per_class) ++full;
+            } else if (uniform) {
+                long j = std::uniform_int_distribution<long>(0, i)(gen);
+                if (j >= per_class) continue;
+                dst = slot[y * per_class + j];
+            } else {
+                continue;
+            }
+            std::memcpy(pixels.data() + dst * image, stream.pixels(k), image);
+        }
+    }
+    pixels.resize(labels.size() * image);
+    return Dataset::packed(std::move(pixels), std::move(labels), stream.channels(), stream.height(), stream.width());
+}
+
+// ───────────────────────────
+// StreamingLoader
+// DataLoader over a dataset file that does not fit in memory. The file is
+// read window by window each epoch and samples pass through a shuffle
+// buffer: every batch takes random samples out of the buffer and refills
+// their places from the stream. Randomness is local (a sample can move at
+// most about a buffer's length from its place in the file), so larger
+// buffers shuffle better. With shuffle off, batches come out in file order.
+//
+// Memory is bounded by budget_bytes, split between the read window, the
+// shuffle buffer (packed uint8) and the one batch that exists as doubles.
+class StreamingLoader {
+public:
+    StreamingLoader(const std::string& path, int batch_size, std::size_t budget_bytes, bool shuffle = true,
+                    std::uint32_t seed = std::random_device{}())
+        : stream_(path, 1), batch_size_(batch_size), shuffle_(shuffle), gen_(seed) {
+        std::size_t image = stream_.sample_size();
+        std::size_t batch_bytes = std::size_t(batch_size) * (image * sizeof(double) + sizeof(int));
+        std::size_t per_sample = image + 1;
+        if (budget_bytes < batch_bytes + 2 * per_sample)
+            throw std::runtime_error("StreamingLoader: budget of " + std::to_string(budget_bytes) +
+                                     " bytes cannot hold one batch of " + std::to_string(batch_bytes));
+        // A quarter of what is left for the read window, the rest for the
+        // shuffle buffer (all of it for the window when not shuffling)
+        std::size_t left = budget_bytes - batch_bytes;
+        std::size_t window = shuffle_ ? left / 4 / per_sample : left / per_sample;
+        if (shuffle_) {
+            std::size_t fits = (left - window * per_sample) / (image + sizeof(int));
+            capacity_ = static_cast<int>(std::min<std::size_t>(fits, stream_.size()));
+            // Fewer slots than a batch would hand batches out nearly in file order
+            if (capacity_ < std::min(batch_size_, stream_.size()))
+                throw std::runtime_error("StreamingLoader: budget of " + std::to_string(budget_bytes) +
+                                         " bytes leaves a shuffle buffer of " + std::to_string(capacity_) +
+                                         " samples, less than one batch; raise it or pass shuffle = false");
+        }
+        stream_.set_window(static_cast<int>(std::min<std::size_t>(window, stream_.size())));
+
+        buffer_pixels_.resize(std::size_t(capacity_) * image);
+        buffer_labels_.resize(capacity_);
+        batch_ = Tensor4D(batch_size_, stream_.channels(), stream_.height(), stream_.width());
+    }
+
+    int batch_size() const { return batch_size_; }
+    std::size_t steps() const { return (std::size_t(stream_.size()) + batch_size_ - 1) / batch_size_; }
+    int shuffle_capacity() const { return capacity_; }
+    double wait_seconds() const { return wait_seconds_; } // this epoch's reads and decoding
+    std::size_t memory_bytes() const {
+        return stream_.window_bytes() + buffer_pixels_.size() + buffer_labels_.size() * sizeof(int) +
+               batch_.size() * sizeof(double);
+    }
+
+    // Rewind the file and (when shuffling) prefill the shuffle buffer
+    void start_epoch() {
+        stream_.rewind();
+        window_n_ = window_k_ = 0;
+        filled_ = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        while (filled_ < capacity_ && pull(filled_)) ++filled_;
+        wait_seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    // Fill `batch` with the next mini-batch; false once the epoch is done
+    bool next(Batch& batch) {
+        auto t0 = std::chrono::steady_clock::now();
+        std::size_t image = stream_.sample_size();
+        const double* value = Dataset::pixel_values();
+        batch.y.resize(batch_size_);
+        int n = 0;
+        for (; n < batch_size_; ++n) {
+            const std::uint8_t* src;
+            int slot = -1;
+            if (capacity_ == 0) { // in file order, straight from the window
+                if (!advance()) break;
+                src = stream_.pixels(window_k_);
+                batch.y[n] = stream_.label(window_k_++);
+            } else {
+                if (filled_ == 0) break;
+                slot = std::uniform_int_distribution<int>(0, filled_ - 1)(gen_);
+                src = buffer_pixels_.data() + slot * image;
+                batch.y[n] = buffer_labels_[slot];
+            }
+            double* out = batch_.sample(n);
+            for (std::size_t p = 0; p < image; ++p) out[p] = value[src[p]];
+            // Refill the emptied slot from the stream, or close the gap once it runs dry
+            if (slot >= 0 && !pull(slot)) move_slot(--filled_, slot);
+        }
+        wait_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (n == 0) return false;
+        batch.y.resize(n);
+        batch.x = Tensor4D::view(batch_.data(), n, stream_.channels(), stream_.height(), stream_.width());
+        return true;
+    }
+
+private:
+    DatasetStream stream_;
+    int batch_size_;
+    bool shuffle_;
+    std::mt19937 gen_;
+    int capacity_ = 0, filled_ = 0;
+    int window_n_ = 0, window_k_ = 0; // samples in the current window, next one to take
+    double wait_seconds_ = 0.0;
+    AlignedVector<std::uint8_t> buffer_pixels_;
+    std::vector<int> buffer_labels_;
+    Tensor4D batch_;
+
+    // Make sure the window has an untaken sample; false at end of file
+    bool advance() {
+        if (window_k_ < window_n_) return true;
+        window_n_ = stream_.next_window();
+        window_k_ = 0;
+        return window_n_ > 0;
+    }
+
+    // Copy the next sample of the stream into buffer slot j
+    bool pull(int j) {
+        if (!advance()) return false;
+        std::size_t image = stream_.sample_size();
+        std::memcpy(buffer_pixels_.data() + j * image, stream_.pixels(window_k_), image);
+        buffer_labels_[j] = stream_.label(window_k_++);
+        return true;
+    }
+
+    void move_slot(int from, int to) {
+        if (from == to) return;
+        std::size_t image = stream_.sample_size();
+        std::memcpy(buffer_pixels_.data() + to * image, buffer_pixels_.data() + from * image, image);
+        buffer_labels_[to] = buffer_labels_[from];
+    }
+};
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef TENSOR_H
+#define TENSOR_H
+
+#include <vector>
+#include <array>
+#include <cstddef>
+#include <new>
+#include <algorithm>
+#include <stdexcept>
+
+// ───────────────────────────
+// 64-byte aligned allocator (one cache line, one AVX-512 register)
+template <typename T, std::size_t Align = 64>
+struct AlignedAllocator {
+    using value_type = T;
+    template <typename U> struct rebind { using other = AlignedAllocator<U, Align>; };
+
+    AlignedAllocator() noexcept = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Align>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+    }
+    void deallocate(T* p, std::size_t) noexcept {
+        ::operator delete(p, std::align_val_t(Align));
+    }
+
+    template <typename U> bool operator==(const AlignedAllocator<U, Align>&) const noexcept { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Align>&) const noexcept { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// ───────────────────────────
+// Tensor
+// Row-major tensor of rank 1, 2 or 4 over a single contiguous buffer.
+// 4D tensors are laid out (batch, channels, height, width); 2D tensors
+// (rows, cols). Reshape never touches the data, so Flatten is free.
+// A tensor either owns its buffer or is a view over memory owned by
+// someone else (see Tensor::view and Workspace). Copies always own.
+class Tensor {
+public:
+    static constexpr int max_rank = 4;
+
+    Tensor() = default;
+
+    explicit Tensor(int d0) { set_shape(1, {d0, 1, 1, 1}); allocate(); }
+    Tensor(int d0, int d1) { set_shape(2, {d0, d1, 1, 1}); allocate(); }
+    Tensor(int d0, int d1, int d2, int d3) { set_shape(4, {d0, d1, d2, d3}); allocate(); }
+
+    // Non-owning views; `data` must outlive the view
+    static Tensor view(double* data, int d0) { return Tensor(data, 1, {d0, 1, 1, 1}); }
+    static Tensor view(double* data, int d0, int d1) { return Tensor(data, 2, {d0, d1, 1, 1}); }
+    static Tensor view(double* data, int d0, int d1, int d2, int d3) {
+        return Tensor(data, 4, {d0, d1, d2, d3});
+    }
+    // A view over `data` with the same shape as `like`
+    static Tensor view_like(double* data, const Tensor& like) { return Tensor(data, like.rank_, like.shape_); }
+
+    Tensor(const Tensor& other)
+        : storage_(other.data_, other.data_ + other.size_),
+          shape_(other.shape_), strides_(other.strides_),
+          rank_(other.rank_), size_(other.size_) {
+        data_ = storage_.data();
+    }
+
+    Tensor(Tensor&& other) noexcept { steal(other); }
+
+    Tensor& operator=(const Tensor& other) {
+        if (this == &other) return *this;
+        if (size_ != other.size_) {
+            storage_.assign(other.data_, other.data_ + other.size_);
+            data_ = storage_.data();
+        } else {
+            std::copy_n(other.data_, other.size_, data_); // reuse the buffer we already have
+        }
+        shape_ = other.shape_;
+        strides_ = other.strides_;
+        rank_ = other.rank_;
+        size_ = other.size_;
+        return *this;
+    }
+
+    Tensor& operator=(Tensor&& other) noexcept {
+        if (this != &other) steal(other);
+        return *this;
+    }
+
+    // ─── shape
+    int rank() const { return rank_; }
+    int dim(int i) const { return shape_[i]; }
+    std::size_t stride(int i) const { return strides_[i]; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool is_view() const { return data_ != nullptr && storage_.empty(); }
+
+    bool same_shape(const Tensor& other) const {
+        return rank_ == other.rank_ && shape_ == other.shape_;
+    }
+
+    Tensor& reshape(int d0, int d1) { return reshape_to(2, {d0, d1, 1, 1}); }
+    Tensor& reshape(int d0, int d1, int d2, int d3) { return reshape_to(4, {d0, d1, d2, d3}); }
+
+    // ─── element access
+    double* data() { return data_; }
+    const double* data() const { return data_; }
+
+    double* begin() { return data_; }
+    double* end() { return data_ + size_; }
+    const double* begin() const { return data_; }
+    const double* end() const { return data_ + size_; }
+
+    double& operator[](std::size_t i) { return data_[i]; }
+    double operator[](std::size_t i) const { return data_[i]; }
+
+    double& operator()(int r, int c) { return data_[r * strides_[0] + c]; }
+    double operator()(int r, int c) const { return data_[r * strides_[0] + c]; }
+
+    double& operator()(int b, int c, int i, int j) {
+        return data_[b * strides_[0] + c * strides_[1] + i * strides_[2] + j];
+    }
+    double operator()(int b, int c, int i, int j) const {
+        return data_[b * strides_[0] + c * strides_[1] + i * strides_[2] + j];
+    }
+
+    // Pointer to the first element of sample / row `b`
+    double* sample(int b) { return data_ + b * strides_[0]; }
+    const double* sample(int b) const { return data_ + b * strides_[0]; }
+
+    void fill(double v) { std::fill_n(data_, size_, v); }
+    void zero() { fill(0.0); }
+
+private:
+    AlignedVector<double> storage_;
+    double* data_ = nullptr;
+    std::array<int, max_rank> shape_{0, 0, 0, 0};
+    std::array<std::size_t, max_rank> strides_{0, 0, 0, 0};
+    int rank_ = 0;
+    std::size_t size_ = 0;
+
+    Tensor(double* data, int rank, std::array<int, max_rank> shape) : data_(data) {
+        set_shape(rank, shape);
+    }
+
+    void set_shape(int rank, std::array<int, max_rank> shape) {
+        rank_ = rank;
+        shape_ = shape;
+        std::size_t s = 1;
+        for (int i = max_rank - 1; i >= 0; --i) {
+            strides_[i] = s;
+            s *= static_cast<std::size_t>(shape_[i]);
+        }
+        size_ = s;
+    }
+
+    void allocate() {
+        storage_.assign(size_, 0.0);
+        data_ = storage_.data();
+    }
+
+    Tensor& reshape_to(int rank, std::array<int, max_rank> shape) {
+        std::size_t old_size = size_;
+        set_shape(rank, shape);
+        if (size_ != old_size)
+            throw std::invalid_argument("Tensor::reshape: element count mismatch");
+        return *this;
+    }
+
+    void steal(Tensor& other) noexcept {
+        storage_ = std::move(other.storage_);
+        data_ = other.data_;
+        shape_ = other.shape_;
+        strides_ = other.strides_;
+        rank_ = other.rank_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.shape_ = {0, 0, 0, 0};
+        other.strides_ = {0, 0, 0, 0};
+        other.rank_ = 0;
+        other.size_ = 0;
+    }
+};
+
+using Tensor4D = Tensor; // (batch, channels, height, width)
+using Matrix = Tensor;   // (rows, cols)
+
+#endif
@@ -1,3 +1,4 @@
+#include "alloc_counter.h"
 #include "data_loader.h"
 #include "model.h"
 #include "train.h"
@@ -27,34 +28,16 @@ void print_progress_bar(size_t current, size_t total, int width = 50) {
 int main() {
     std::cout << "📦 Loading MNIST data...\n";
 
-    std::vector<Image> all_images = load_csv_images("../MNIST/train_images.csv");
-    std::vector<int> all_labels = load_csv_labels("../MNIST/train_labels.csv");
-
-    std::vector<Image> x_train_flat, x_test_flat;
-    std::vector<int> y_train, y_test;
-
-    select_balanced_subset(all_images, all_labels, x_train_flat, y_train, 500);
-    select_balanced_subset(all_images, all_labels, x_test_flat, y_test, 10);
-
-    auto to_tensor = [](const std::vector<Image>& data) {
-        // Change float to double to match Tensor4D definition
-        Tensor4D out(data.size(), std::vector<std::vector<std::vector<double>>>(
-                                      1, std::vector<std::vector<double>>(
-                                             28, std::vector<double>(28, 0.0))));
-        for (size_t i = 0; i < data.size(); ++i)
-            for (int r = 0; r < 28; ++r)
-                for (int c = 0; c < 28; ++c)
-                    out[i][0][r][c] = data[i][r * 28 + c];
-        return out;
-    };
-
-    Tensor4D x_train = to_tensor(x_train_flat);
-    Tensor4D x_test = to_tensor(x_test_flat);
+    Dataset all = load_csv_dataset("../MNIST/train_images.csv", "../MNIST/train_labels.csv");
+    auto label = [&](int i) { return all.labels[i]; };
+    Dataset train = all.subset(balanced_indices(all.size(), label, 500));
+    Dataset test = all.subset(balanced_indices(all.size(), label, 10));
 
     CNN model; // Use the namespace ML
     double lr = 10;  // Use double for consistency
     int epochs = 5;
     int batch_size = 64;
+    DataLoader loader(train, batch_size);
 
     std::vector<double> train_loss, train_acc; // Use double
 
@@ -63,39 +46,39 @@ int main() {
     for (int epoch = 0; epoch < epochs; ++epoch) {
         std::cout << "\n📘 Epoch " << (epoch + 1) << "/" << epochs << "\n";
 
-        std::vector<int> indices(x_train.size());
-        std::iota(indices.begin(), indices.end(), 0);
-        std::shuffle(indices.begin(), indices.end(), std::mt19937(std::random_device{}()));
-
-        Tensor4D x_train_shuffled;
-        std::vector<int> y_train_shuffled;
-
-        for (int idx : indices) {
-            x_train_shuffled.push_back(x_train[idx]);
-            y_train_shuffled.push_back(y_train[idx]);
-        }
+        loader.start_epoch();
 
         double epoch_loss = 0.0; // Use double
         int correct = 0;
         int total = 0;
 
-        size_t steps = (x_train.size() + batch_size - 1) / batch_size;
+        size_t steps = loader.steps();
 
-        for (size_t step = 0; step < steps; ++step) {
-            size_t i = step * batch_size;
-            size_t end = std::min(i + batch_size, x_train.size());
-            Tensor4D x_batch(x_train_shuffled.begin() + i, x_train_shuffled.begin() + end);
-            std::vector<int> y_batch(y_train_shuffled.begin() + i, y_train_shuffled.begin() + end);
+        Batch batch;
+        for (size_t step = 0; loader.next(batch); ++step) {
+            const Tensor4D& x_batch = batch.x;
+            const std::vector<int>& y_batch = batch.y;
 
+            long allocs_before = heap_allocations();
             double loss = model.forward(x_batch, y_batch); // Use double
             model.backward(lr);
+            long step_allocs = heap_allocations() - allocs_before;
+
+            // The first step sizes the workspace; every later full step must not allocate
+            if (step == 1 && epoch == 0) {
+                std::cout << "\n🔍 Heap allocations in a warmed-up training step: " << step_allocs << std::endl;
+                if (step_allocs != 0) {
+                    std::cout << "❌ Training step should not allocate after warm-up\n";
+                    return 1;
+                }
+            }
             // Inspect gradient updates after backward()
             if (step == 0 && epoch == 0) {
                 // Print weight before and after update (for fc1)
-                static double previous_weight = model.fc1.weights[0][0]; // Use double
+                static double previous_weight = model.fc1.weights(0, 0); // Use double
                 std::cout << "\n🔍 Initial fc1.weights[0][0]: " << previous_weight << std::endl;
 
-                double new_weight = model.fc1.weights[0][0]; // Use double
+                double new_weight = model.fc1.weights(0, 0); // Use double
                 std::cout << "🔁 After 1st backward, fc1.weights[0][0]: " << new_weight << std::endl;
 
                 double diff = new_weight - previous_weight; // Use double
@@ -105,9 +88,9 @@ int main() {
             // Also inspect softmax outputs
             if (step == 0 && epoch == 0) {
                 std::cout << "\n🧠 Softmax output for first sample: ";
-                const auto& probs = model.loss_fn.probs[0];
-                for (double p : probs) // Use double
-                    std::cout << std::fixed << std::setprecision(3) << p << " ";
+                const auto& probs = model.loss_fn.probs;
+                for (int j = 0; j < probs.dim(1); ++j) // Use double
+                    std::cout << std::fixed << std::setprecision(3) << probs(0, j) << " ";
                 std::cout << "\nTarget label: " << y_batch[0] << std::endl;
             }
 
@@ -132,8 +115,8 @@ int main() {
                   << train_acc.back() * 100.0 << "%\n"; // Use double
     }
 
-    std::cout << "💾 Saving model to 'trained_model'...\n";
-    save_model(model, "trained_model"); // Use the namespace ML
+    std::cout << "💾 Saving model to 'trained_model.ckpt'...\n";
+    save_model(model, "trained_model.ckpt"); // Use the namespace ML
 
     std::cout << "🎉 Done.\n";
     return 0;
@@ -0,0 +1,85 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+// ───────────────────────────
+// Fixed set of worker threads that run one job at a time: run(f) calls
+// f(t) for every t in [0, size()) — t = 0 on the calling thread — and
+// returns when all of them are done. The job is passed by pointer, not
+// wrapped in std::function, so dispatching does not touch the heap.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads) : size_(threads < 1 ? 1 : threads) {
+        for (int t = 1; t < size_; ++t)
+            workers_.emplace_back([this, t] { worker_loop(t); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        start_.notify_all();
+        for (std::thread& w : workers_) w.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return size_; }
+
+    template <typename F>
+    void run(F& f) {
+        if (size_ == 1) {
+            f(0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &f;
+            call_ = [](void* job, int t) { (*static_cast<F*>(job))(t); };
+            pending_ = size_ - 1;
+            ++generation_;
+        }
+        start_.notify_all();
+        f(0);
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+private:
+    int size_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_, done_;
+    void* job_ = nullptr;
+    void (*call_)(void*, int) = nullptr;
+    int pending_ = 0;
+    long generation_ = 0;
+    bool stopping_ = false;
+
+    void worker_loop(int t) {
+        long seen = 0;
+        for (;;) {
+            void* job;
+            void (*call)(void*, int);
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+                if (stopping_) return;
+                seen = generation_;
+                job = job_;
+                call = call_;
+            }
+            call(job, t);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0) done_.notify_one();
+        }
+    }
+};
+
+#endif
@@ -2,24 +2,19 @@
 #define UTILS_H
 
 #include "model.h"
+#include "checkpoint.h"
 #include <vector>
 #include <string>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <iomanip>
+#include <sys/resource.h>
 
 // ─────────────────────────────────────────────
-// Save a 1D vector
-void save_vector(const std::vector<double>& vec, const std::string& filename) {
-    std::ofstream out(filename);
-    if (!out.is_open()) throw std::runtime_error("Cannot open file: " + filename);
-    out << vec.size() << "\n";
-    out << std::setprecision(17);
-    for (double val : vec) out << val << " ";
-    out << "\n";
-    out.close();
-}
+// Text checkpoints (one file per tensor, written by earlier versions).
+// Kept only so old models can be imported; new ones are saved with
+// save_model as a single binary checkpoint.
 
 // Load a 1D vector
 std::vector<double> load_vector(const std::string& filename) {
@@ -32,97 +27,83 @@ std::vector<double> load_vector(const std::string& filename) {
     return vec;
 }
 
-// ─────────────────────────────────────────────
-// Save a 2D matrix
-void save_matrix(const std::vector<std::vector<double>>& mat, const std::string& filename) {
-    std::ofstream out(filename);
-    if (!out.is_open()) throw std::runtime_error("Cannot open file: " + filename);
-    out << mat.size() << " " << (mat.empty() ? 0 : mat[0].size()) << "\n";
-    out << std::setprecision(17);
-    for (const auto& row : mat) {
-        for (double val : row) out << val << " ";
-        out << "\n";
-    }
-    out.close();
-}
-
 // Load a 2D matrix
-std::vector<std::vector<double>> load_matrix(const std::string& filename) {
+Matrix load_matrix(const std::string& filename) {
     std::ifstream in(filename);
     if (!in.is_open()) throw std::runtime_error("Cannot open file: " + filename);
     int rows, cols;
     in >> rows >> cols;
-    std::vector<std::vector<double>> mat(rows, std::vector<double>(cols));
-    for (int i = 0; i < rows; ++i)
-        for (int j = 0; j < cols; ++j)
-            in >> mat[i][j];
+    Matrix mat(rows, cols);
+    for (double& val : mat) in >> val;
     return mat;
 }
 
-// ─────────────────────────────────────────────
-// Save a 4D tensor (for Conv2D weights)
-void save_tensor4d(const Tensor4D& tensor, const std::string& filename) {
-    std::ofstream out(filename);
-    if (!out.is_open()) throw std::runtime_error("Cannot open file: " + filename);
-    int d1 = tensor.size();
-    int d2 = tensor[0].size();
-    int d3 = tensor[0][0].size();
-    int d4 = tensor[0][0][0].size();
-    out << d1 << " " << d2 << " " << d3 << " " << d4 << "\n";
-    out << std::setprecision(17);
-    for (const auto& a : tensor)
-        for (const auto& b : a)
-            for (const auto& c : b)
-                for (double val : c)
-                    out << val << " ";
-    out.close();
-}
-
 // Load a 4D tensor (for Conv2D weights)
 Tensor4D load_tensor4d(const std::string& filename) {
     std::ifstream in(filename);
     if (!in.is_open()) throw std::runtime_error("Cannot open file: " + filename);
     int d1, d2, d3, d4;
     in >> d1 >> d2 >> d3 >> d4;
-    Tensor4D tensor(d1,
-        std::vector<std::vector<std::vector<double>>>(
-            d2, std::vector<std::vector<double>>(
-                d3, std::vector<double>(d4)
-            )
-        )
-    );
-    for (int i = 0; i < d1; ++i)
-        for (int j = 0; j < d2; ++j)
-            for (int k = 0; k < d3; ++k)
-                for (int l = 0; l < d4; ++l)
-                    in >> tensor[i][j][k][l];
+    Tensor4D tensor(d1, d2, d3, d4);
+    for (double& val : tensor)
+        in >> val;
     return tensor;
 }
 
-// ─────────────────────────────────────────────
-// Save full model (Conv2D + Dense)
-void save_model(const CNN& model, const std::string& prefix) {
+// Copy loaded values into a model parameter. Parameters are views into
+// CNN::parameters, so they are written in place, never re-pointed.
+template <typename Values>
+void assign_parameter(Tensor& param, const Values& loaded, const std::string& name) {
+    if (std::size_t(loaded.size()) != param.size())
+        throw std::runtime_error("Parameter size mismatch: " + name);
+    std::copy(loaded.begin(), loaded.end(), param.begin());
+}
 
-    save_tensor4d(model.c1.weights, prefix + "_c1_weights.txt");
-    save_vector(model.c1.biases,    prefix + "_c1_biases.txt");
+// Import a model saved in the old text format (prefix_c1_weights.txt, ...)
+void import_text_model(CNN& model, const std::string& prefix) {
+    assign_parameter(model.c1.weights, load_tensor4d(prefix + "_c1_weights.txt"), "c1 weights");
+    assign_parameter(model.c1.biases,  load_vector(prefix + "_c1_biases.txt"), "c1 biases");
 
-    save_matrix(model.fc1.weights, prefix + "_fc1_weights.txt");
-    save_vector(model.fc1.biases,  prefix + "_fc1_biases.txt");
+    assign_parameter(model.fc1.weights, load_matrix(prefix + "_fc1_weights.txt"), "fc1 weights");
+    assign_parameter(model.fc1.biases,  load_vector(prefix + "_fc1_biases.txt"), "fc1 biases");
 
-    save_matrix(model.fc2.weights, prefix + "_fc2_weights.txt");
-    save_vector(model.fc2.biases,  prefix + "_fc2_biases.txt");
+    assign_parameter(model.fc2.weights, load_matrix(prefix + "_fc2_weights.txt"), "fc2 weights");
+    assign_parameter(model.fc2.biases,  load_vector(prefix + "_fc2_biases.txt"), "fc2 biases");
+    model.weights_changed();
+    model.prepare_inference();
 }
 
-// Load full model (Conv2D + Dense)
-void load_model(CNN& model, const std::string& prefix) {
-    model.c1.weights = load_tensor4d(prefix + "_c1_weights.txt");
-    model.c1.biases  = load_vector(prefix + "_c1_biases.txt");
+// ─────────────────────────────────────────────
+// Every tensor a checkpoint holds, under its name in the file
+std::vector<NamedTensor> model_tensors(const CNN& model) {
+    return {{"c1.weights", &model.c1.weights},   {"c1.biases", &model.c1.biases},
+            {"fc1.weights", &model.fc1.weights}, {"fc1.biases", &model.fc1.biases},
+            {"fc2.weights", &model.fc2.weights}, {"fc2.biases", &model.fc2.biases}};
+}
 
-    model.fc1.weights = load_matrix(prefix + "_fc1_weights.txt");
-    model.fc1.biases  = load_vector(prefix + "_fc1_biases.txt");
+// Save full model (Conv2D + Dense) as one binary checkpoint (checkpoint.h)
+void save_model(const CNN& model, const std::string& path) {
+    save_checkpoint(model_tensors(model), path);
+}
+
+// Load full model (Conv2D + Dense) from a binary checkpoint
+void load_model(CNN& model, const std::string& path) {
+    Checkpoint checkpoint(path);
+    checkpoint.read("c1.weights", model.c1.weights);
+    checkpoint.read("c1.biases", model.c1.biases);
+    checkpoint.read("fc1.weights", model.fc1.weights);
+    checkpoint.read("fc1.biases", model.fc1.biases);
+    checkpoint.read("fc2.weights", model.fc2.weights);
+    checkpoint.read("fc2.biases", model.fc2.biases);
+    model.weights_changed();
+    model.prepare_inference();
+}
 
-    model.fc2.weights = load_matrix(prefix + "_fc2_weights.txt");
-    model.fc2.biases  = load_vector(prefix + "_fc2_biases.txt");
+// Peak resident set size of this process so far, in MB
+double peak_rss_mb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0; // Linux reports KB
 }
 
 #endif // UTILS_H
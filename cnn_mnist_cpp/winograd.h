@@ -0,0 +1,128 @@
+#ifndef WINOGRAD_H
+#define WINOGRAD_H
+
+#include <algorithm>
+#include <cstddef>
+
+// ───────────────────────────
+// Winograd F(2×2, 3×3) for stride-1 3×3 convolutions.
+//   U = G g Gᵀ          (4×4, per (out, in) filter, cached by Conv2D)
+//   V = Bᵀ d B          (4×4, per input tile and channel)
+//   Y = Aᵀ [Σ_c U ⊙ V] A (2×2 outputs per tile)
+// 16 multiplies per 2×2 outputs and channel instead of 36.
+//
+// Accuracy: G, Bᵀ and Aᵀ hold only 0, ±1/2 and ±1, so the transforms are
+// exact in binary floating point apart from the additions they perform.
+// The result differs from the direct sum by reassociation only. With
+// S = Σ |x·w| over an output's receptive field, C input channels and
+// ε = 2⁻⁵², the usual summation bounds on both sides give
+//   |y_winograd − y_direct| ≤ (9·C + 16)·ε·S.
+// bench.cpp measures 2–6 ε·S for the shapes we run.
+namespace winograd {
+
+// U = G g Gᵀ for one 3×3 filter (row-major g), optionally rotated by 180°
+inline void transform_filter(const double* g, double* u, bool rotate = false) {
+    double k[9];
+    for (int t = 0; t < 9; ++t) k[t] = rotate ? g[8 - t] : g[t];
+
+    double tmp[4][3]; // G g
+    for (int n = 0; n < 3; ++n) {
+        double g0 = k[n], g1 = k[3 + n], g2 = k[6 + n];
+        tmp[0][n] = g0;
+        tmp[1][n] = 0.5 * (g0 + g1 + g2);
+        tmp[2][n] = 0.5 * (g0 - g1 + g2);
+        tmp[3][n] = g2;
+    }
+    for (int r = 0; r < 4; ++r) { // (G g) Gᵀ
+        double t0 = tmp[r][0], t1 = tmp[r][1], t2 = tmp[r][2];
+        u[r * 4 + 0] = t0;
+        u[r * 4 + 1] = 0.5 * (t0 + t1 + t2);
+        u[r * 4 + 2] = 0.5 * (t0 - t1 + t2);
+        u[r * 4 + 3] = t2;
+    }
+}
+
+// V = Bᵀ d B for one 4×4 tile
+inline void transform_input(const double d[16], double* v) {
+    double tmp[16]; // Bᵀ d
+    for (int n = 0; n < 4; ++n) {
+        double d0 = d[n], d1 = d[4 + n], d2 = d[8 + n], d3 = d[12 + n];
+        tmp[n] = d0 - d2;
+        tmp[4 + n] = d1 + d2;
+        tmp[8 + n] = d2 - d1;
+        tmp[12 + n] = d1 - d3;
+    }
+    for (int r = 0; r < 4; ++r) { // (Bᵀ d) B
+        double t0 = tmp[r * 4], t1 = tmp[r * 4 + 1], t2 = tmp[r * 4 + 2], t3 = tmp[r * 4 + 3];
+        v[r * 4 + 0] = t0 - t2;
+        v[r * 4 + 1] = t1 + t2;
+        v[r * 4 + 2] = t2 - t1;
+        v[r * 4 + 3] = t1 - t3;
+    }
+}
+
+// Y = Aᵀ m A for one 4×4 tile
+inline void transform_output(const double m[16], double y[4]) {
+    double tmp[8]; // Aᵀ m
+    for (int n = 0; n < 4; ++n) {
+        tmp[n] = m[n] + m[4 + n] + m[8 + n];
+        tmp[4 + n] = m[4 + n] - m[8 + n] - m[12 + n];
+    }
+    for (int r = 0; r < 2; ++r) {
+        const double* t = tmp + r * 4;
+        y[r * 2 + 0] = t[0] + t[1] + t[2];
+        y[r * 2 + 1] = t[1] - t[2] - t[3];
+    }
+}
+
+// Convolve one image x (in_ch, h, w), implicitly zero-padded by `pad` on
+// every side, with pre-transformed filters u (out_ch, in_ch, 16).
+// out is (out_ch, h + 2·pad − 2, w + 2·pad − 2); biases may be null.
+// v is scratch for in_ch·16 doubles.
+inline void conv3x3(const double* x, int in_ch, int h, int w, int pad,
+                    const double* u, int out_ch, const double* biases,
+                    double* out, double* v) {
+    int out_h = h + 2 * pad - 2;
+    int out_w = w + 2 * pad - 2;
+
+    for (int ti = 0; ti < out_h; ti += 2) {
+        for (int tj = 0; tj < out_w; tj += 2) {
+            // Input tile rows ti-pad .. ti-pad+3, zero outside the image
+            for (int c = 0; c < in_ch; ++c) {
+                const double* plane = x + std::size_t(c) * h * w;
+                double d[16];
+                for (int r = 0; r < 4; ++r) {
+                    int row = ti - pad + r;
+                    for (int s = 0; s < 4; ++s) {
+                        int col = tj - pad + s;
+                        d[r * 4 + s] = (row >= 0 && row < h && col >= 0 && col < w)
+                                           ? plane[row * w + col] : 0.0;
+                    }
+                }
+                transform_input(d, v + c * 16);
+            }
+
+            int rows = std::min(2, out_h - ti);
+            int cols = std::min(2, out_w - tj);
+            for (int o = 0; o < out_ch; ++o) {
+                double m[16] = {};
+                const double* uo = u + std::size_t(o) * in_ch * 16;
+                for (int c = 0; c < in_ch; ++c)
+                    for (int t = 0; t < 16; ++t)
+                        m[t] += uo[c * 16 + t] * v[c * 16 + t];
+
+                double y[4];
+                transform_output(m, y);
+                double bias = biases ? biases[o] : 0.0;
+                double* dst = out + std::size_t(o) * out_h * out_w;
+                for (int r = 0; r < rows; ++r)
+                    for (int s = 0; s < cols; ++s)
+                        dst[(ti + r) * out_w + tj + s] = y[r * 2 + s] + bias;
+            }
+        }
+    }
+}
+
+} // namespace winograd
+
+#endif
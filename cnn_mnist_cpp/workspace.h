@@ -0,0 +1,65 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include "tensor.h"
+#include <cstddef>
+#include <cstdint>
+
+// ───────────────────────────
+// Workspace
+// Bump allocator over one aligned block. Layers carve their activation,
+// mask and gradient buffers out of it once per batch shape and reuse them
+// every step, so a warmed-up training step does not touch the heap.
+//
+// Binding is two-pass: when the block is too small, take() hands out
+// empty views and only records how much was asked for; the owner then
+// calls reserve(requested()) and binds again.
+class Workspace {
+public:
+    // Every buffer starts on a 64-byte boundary
+    static constexpr std::size_t align_doubles = 64 / sizeof(double);
+
+    void reserve(std::size_t doubles) {
+        if (doubles > block_.size()) block_.assign(doubles, 0.0);
+        rewind();
+    }
+
+    void rewind() {
+        offset_ = 0;
+        requested_ = 0;
+    }
+
+    bool overflowed() const { return requested_ > block_.size(); }
+    std::size_t requested() const { return requested_; }
+    std::size_t capacity() const { return block_.size(); }
+
+    Tensor take(int d0) { return Tensor::view(claim(d0), d0); }
+    Tensor take(int d0, int d1) { return Tensor::view(claim(std::size_t(d0) * d1), d0, d1); }
+    Tensor take(int d0, int d1, int d2, int d3) {
+        return Tensor::view(claim(std::size_t(d0) * d1 * d2 * d3), d0, d1, d2, d3);
+    }
+
+    // Raw bytes (e.g. argmax records), still 64-byte aligned
+    std::uint8_t* take_bytes(std::size_t n) {
+        return reinterpret_cast<std::uint8_t*>(claim((n + sizeof(double) - 1) / sizeof(double)));
+    }
+
+private:
+    AlignedVector<double> block_;
+    std::size_t offset_ = 0;
+    std::size_t requested_ = 0;
+
+    double* claim(std::size_t n) {
+        std::size_t padded = (n + align_doubles - 1) / align_doubles * align_doubles;
+        requested_ = offset_ + padded;
+        if (requested_ > block_.size()) {
+            offset_ = requested_;
+            return nullptr; // dry run, see overflowed()
+        }
+        double* p = block_.data() + offset_;
+        offset_ = requested_;
+        return p;
+    }
+};
+
+#endif